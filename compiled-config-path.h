@@ -0,0 +1,279 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COMPILED_CONFIG_PATH_H
+#define COMPILED_CONFIG_PATH_H
+
+#include <map>
+#include <string>
+#include "ns3/core-module.h"
+
+// ===========================================================================
+//
+// A Config path that is parsed and resolved once.  Config::Set and
+// Config::Connect re-parse their path and walk the object graph on every
+// call; a CompiledConfigPath resolves the objects on construction and keeps
+// them, so each later Set or Connect only touches the matched objects.
+//
+// Besides the usual Config syntax ('*', 'N', '[N-M]' and 'A|B' for list
+// indices), an index may be written as a bracketed list of numbers and
+// ranges, which becomes the alternatives of its elements:
+//
+//   CompiledConfigPath phy ("/NodeList/[1,6-9]/DeviceList/0/$ns3::WifiNetDevice"
+//                           "/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel");
+//   phy.Set (PointerValue (em));
+//
+// The last path segment is the attribute or trace source; everything before
+// it selects the objects.  Objects created after the path was compiled are
+// not seen until Refresh.  CompiledConfigPath::Lookup shares one compiled
+// path per path string across a script, until Simulator::Destroy.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief A Config path resolved once to its matching objects.
+ */
+class CompiledConfigPath
+{
+public:
+  CompiledConfigPath ();
+  /**
+   * Parse and resolve \p path.
+   * \param path a Config path ending in an attribute or trace source name
+   */
+  explicit CompiledConfigPath (std::string path);
+
+  /**
+   * \param path a Config path
+   * \return the shared compiled path for \p path, compiled on first use
+   */
+  static CompiledConfigPath &Lookup (std::string path);
+
+  /**
+   * Rewrite bracketed index lists to Config syntax: [1,6-9] becomes
+   * 1|[6-9], and a plain range such as [0-5] stays as it is.
+   * \param path a path using bracketed lists
+   * \return the equivalent Config path
+   */
+  static std::string Translate (std::string path);
+
+  /**
+   * Resolve the path again, e.g. after nodes or devices were added.
+   */
+  void Refresh (void);
+
+  /**
+   * \return the number of matched objects
+   */
+  uint32_t GetN (void) const;
+  /**
+   * \param i the match index
+   * \return the matched object
+   */
+  Ptr<Object> Get (uint32_t i) const;
+  /**
+   * \return the attribute or trace source name the path ends in
+   */
+  std::string GetName (void) const;
+
+  /**
+   * Set the attribute on every matched object.
+   * \param value the new value
+   */
+  void Set (const AttributeValue &value) const;
+  /**
+   * Connect \p cb to the trace source of every matched object, with the
+   * matched path as context.
+   * \param cb the callback
+   */
+  void Connect (const CallbackBase &cb) const;
+  /**
+   * Connect \p cb to the trace source of every matched object.
+   * \param cb the callback
+   */
+  void ConnectWithoutContext (const CallbackBase &cb) const;
+
+private:
+  /**
+   * \return the compiled paths shared by Lookup
+   */
+  static std::map<std::string, CompiledConfigPath> &GetCache (void);
+  /**
+   * Drop the shared paths and the objects they hold.
+   */
+  static void ClearCache (void);
+
+  std::string            m_objectPath;
+  std::string            m_name;
+  Config::MatchContainer m_matches;
+};
+
+inline
+CompiledConfigPath::CompiledConfigPath ()
+{
+}
+
+inline
+CompiledConfigPath::CompiledConfigPath (std::string path)
+{
+  path = Translate (path);
+  std::string::size_type slash = path.rfind ('/');
+  if (slash == std::string::npos || slash == 0 || slash + 1 == path.size ())
+    {
+      NS_FATAL_ERROR ("Config path " << path << " does not end in an attribute name");
+    }
+  m_objectPath = path.substr (0, slash);
+  m_name = path.substr (slash + 1);
+  Refresh ();
+}
+
+inline std::map<std::string, CompiledConfigPath> &
+CompiledConfigPath::GetCache (void)
+{
+  static std::map<std::string, CompiledConfigPath> cache;
+  return cache;
+}
+
+inline void
+CompiledConfigPath::ClearCache (void)
+{
+  GetCache ().clear ();
+}
+
+inline CompiledConfigPath &
+CompiledConfigPath::Lookup (std::string path)
+{
+  std::map<std::string, CompiledConfigPath> &cache = GetCache ();
+  std::map<std::string, CompiledConfigPath>::iterator it = cache.find (path);
+  if (it == cache.end ())
+    {
+      if (cache.empty ())
+        {
+          // The matches hold their objects; let them go with the simulation
+          Simulator::ScheduleDestroy (&CompiledConfigPath::ClearCache);
+        }
+      it = cache.insert (std::make_pair (path, CompiledConfigPath (path))).first;
+    }
+  return it->second;
+}
+
+inline std::string
+CompiledConfigPath::Translate (std::string path)
+{
+  // Config knows a range only as a whole element, [N-M], so each range of
+  // a list keeps its brackets and only the commas become alternatives.
+  std::string out;
+  out.reserve (path.size () + 8);
+  std::string element;
+  bool inList = false;
+  for (std::string::size_type i = 0; i < path.size (); ++i)
+    {
+      char c = path[i];
+      if (c == '[' && !inList)
+        {
+          inList = true;
+          element.clear ();
+        }
+      else if ((c == ',' || c == ']') && inList)
+        {
+          if (element.empty () || element[0] == '-' || element[element.size () - 1] == '-')
+            {
+              NS_FATAL_ERROR ("Empty or open index in index list of " << path);
+            }
+          out += element.find ('-') != std::string::npos ? "[" + element + "]" : element;
+          out += c == ',' ? "|" : "";
+          inList = c == ',';
+          element.clear ();
+        }
+      else if (inList)
+        {
+          if ((c >= '0' && c <= '9') || c == '-')
+            {
+              element += c;
+            }
+          else if (c != ' ')
+            {
+              NS_FATAL_ERROR ("Unexpected '" << c << "' in index list of " << path);
+            }
+        }
+      else
+        {
+          out += c;
+        }
+    }
+  if (inList)
+    {
+      NS_FATAL_ERROR ("Unterminated index list in " << path);
+    }
+  return out;
+}
+
+inline void
+CompiledConfigPath::Refresh (void)
+{
+  m_matches = Config::LookupMatches (m_objectPath);
+}
+
+inline uint32_t
+CompiledConfigPath::GetN (void) const
+{
+  return m_matches.GetN ();
+}
+
+inline Ptr<Object>
+CompiledConfigPath::Get (uint32_t i) const
+{
+  return m_matches.Get (i);
+}
+
+inline std::string
+CompiledConfigPath::GetName (void) const
+{
+  return m_name;
+}
+
+inline void
+CompiledConfigPath::Set (const AttributeValue &value) const
+{
+  for (uint32_t i = 0; i < m_matches.GetN (); ++i)
+    {
+      m_matches.Get (i)->SetAttribute (m_name, value);
+    }
+}
+
+inline void
+CompiledConfigPath::Connect (const CallbackBase &cb) const
+{
+  for (uint32_t i = 0; i < m_matches.GetN (); ++i)
+    {
+      m_matches.Get (i)->TraceConnect (m_name, m_matches.GetMatchedPath (i) + "/" + m_name, cb);
+    }
+}
+
+inline void
+CompiledConfigPath::ConnectWithoutContext (const CallbackBase &cb) const
+{
+  for (uint32_t i = 0; i < m_matches.GetN (); ++i)
+    {
+      m_matches.Get (i)->TraceConnectWithoutContext (m_name, cb);
+    }
+}
+
+} // namespace ns3
+
+#endif /* COMPILED_CONFIG_PATH_H */
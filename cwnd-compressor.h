@@ -0,0 +1,372 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CWND_COMPRESSOR_H
+#define CWND_COMPRESSOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <ostream>
+#include <vector>
+#include "ns3/core-module.h"
+
+// ===========================================================================
+//
+// A congestion-window trace sink that writes only change points instead of
+// every update.  Slow-start and congestion-avoidance ramps are monotone and
+// nearly linear, so most updates can be dropped without changing the plot.
+// Two modes are available:
+//
+//   PIECEWISE_LINEAR  streaming: the output is a polyline that stays within
+//                     the error bound (in bytes) of every dropped update;
+//                     nothing is buffered
+//   LTTB              buffered: the trace is decimated on Flush to about the
+//                     given number of points with largest-triangle-three-
+//                     buckets, for plotting
+//
+// In both modes every decrease of the window is a marker: the last value
+// before it and the first value after it are always written, so loss,
+// fast-recovery and the restart of slow start show exactly.  Each output
+// line is "<time>\t<cwnd>".
+//
+//   Ptr<CwndCompressor> cwnd = Create<CwndCompressor> (stream->GetStream ());
+//   cwnd->SetErrorBound (1000);
+//   socket->TraceConnectWithoutContext ("CongestionWindow",
+//                                       MakeCallback (&CwndCompressor::CwndChange, cwnd));
+//   Simulator::Run ();
+//   cwnd->Flush ();
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Writes the change points of a congestion-window trace.
+ */
+class CwndCompressor : public SimpleRefCount<CwndCompressor>
+{
+public:
+  /// The compression mode.
+  enum Mode
+  {
+    PIECEWISE_LINEAR,
+    LTTB
+  };
+
+  /// A traced value.
+  struct Point
+  {
+    double time;  //!< time in seconds
+    double value; //!< the value
+  };
+
+  /**
+   * \param os the output stream; it must outlive the last Flush
+   */
+  CwndCompressor (std::ostream *os);
+
+  /**
+   * Use PIECEWISE_LINEAR mode, the default.
+   * \param bytes the largest distance of a dropped update from the output
+   */
+  void SetErrorBound (double bytes);
+  /**
+   * Use LTTB mode.
+   * \param points the number of points to keep, besides the markers
+   */
+  void SetLttb (uint32_t points);
+
+  /**
+   * The CongestionWindow trace sink.
+   * \param oldCwnd the previous window
+   * \param newCwnd the new window
+   */
+  void CwndChange (uint32_t oldCwnd, uint32_t newCwnd);
+  /**
+   * Add a value at an explicit time.
+   * \param time time in seconds, not before the previous value
+   * \param value the value
+   */
+  void Add (double time, double value);
+  /**
+   * Write the points still held back.  Call once after the run.
+   */
+  void Flush (void);
+
+  /**
+   * \return the number of values added
+   */
+  uint64_t GetNUpdates (void) const;
+  /**
+   * \return the number of points written
+   */
+  uint64_t GetNPoints (void) const;
+
+  /**
+   * Largest-triangle-three-buckets decimation.
+   * \param points the series, in time order
+   * \param threshold the number of points to select, at least 3
+   * \return the indices of the selected points, ascending
+   */
+  static std::vector<uint32_t> Lttb (const std::vector<Point> &points, uint32_t threshold);
+
+private:
+  void Emit (const Point &p);
+  void Restart (const Point &anchor);
+
+  std::ostream      *m_os;
+  Mode               m_mode;
+  double             m_error;
+  uint32_t           m_threshold;
+  uint64_t           m_updates;
+  uint64_t           m_written;
+
+  // PIECEWISE_LINEAR state: the current segment starts at m_anchor, and
+  // every slope in [m_lower, m_upper] passes within m_error of all the
+  // updates since.
+  bool               m_started;
+  bool               m_lastWritten;
+  Point              m_anchor;
+  Point              m_last;
+  double             m_lower;
+  double             m_upper;
+
+  // LTTB state
+  std::vector<Point>    m_points;
+  std::vector<uint32_t> m_markers;
+};
+
+inline
+CwndCompressor::CwndCompressor (std::ostream *os)
+  : m_os (os),
+    m_mode (PIECEWISE_LINEAR),
+    m_error (0),
+    m_threshold (0),
+    m_updates (0),
+    m_written (0),
+    m_started (false),
+    m_lastWritten (false),
+    m_lower (0),
+    m_upper (0)
+{
+}
+
+inline void
+CwndCompressor::SetErrorBound (double bytes)
+{
+  NS_ASSERT (m_updates == 0 && bytes >= 0);
+  m_mode = PIECEWISE_LINEAR;
+  m_error = bytes;
+}
+
+inline void
+CwndCompressor::SetLttb (uint32_t points)
+{
+  NS_ASSERT (m_updates == 0 && points >= 3);
+  m_mode = LTTB;
+  m_threshold = points;
+}
+
+inline uint64_t
+CwndCompressor::GetNUpdates (void) const
+{
+  return m_updates;
+}
+
+inline uint64_t
+CwndCompressor::GetNPoints (void) const
+{
+  return m_written;
+}
+
+inline void
+CwndCompressor::CwndChange (uint32_t oldCwnd, uint32_t newCwnd)
+{
+  Add (Simulator::Now ().GetSeconds (), newCwnd);
+}
+
+inline void
+CwndCompressor::Emit (const Point &p)
+{
+  char line[64];
+  int n = std::snprintf (line, sizeof (line), "%.6f\t%.15g\n", p.time, p.value);
+  m_os->write (line, n);
+  ++m_written;
+}
+
+inline void
+CwndCompressor::Restart (const Point &anchor)
+{
+  m_anchor = anchor;
+  m_lower = -HUGE_VAL;
+  m_upper = HUGE_VAL;
+}
+
+inline void
+CwndCompressor::Add (double time, double value)
+{
+  Point p = { time, value };
+  bool drop = m_updates > 0 && value < m_last.value;
+  ++m_updates;
+
+  if (m_mode == LTTB)
+    {
+      if (drop)
+        {
+          m_markers.push_back (m_points.size () - 1);
+          m_markers.push_back (m_points.size ());
+        }
+      m_points.push_back (p);
+      m_last = p;
+      return;
+    }
+
+  if (!m_started)
+    {
+      m_started = true;
+      Emit (p);
+      Restart (p);
+    }
+  else if (drop || time <= m_anchor.time)
+    {
+      // A marker, or a jump at the anchor time: both ends are kept.
+      if (!m_lastWritten)
+        {
+          Emit (m_last);
+        }
+      Emit (p);
+      Restart (p);
+    }
+  else
+    {
+      double dt = time - m_anchor.time;
+      double slope = (value - m_anchor.value) / dt;
+      if (slope < m_lower || slope > m_upper)
+        {
+          // The line from the anchor to the last update covers everything
+          // in between; start the next segment there.
+          Emit (m_last);
+          Restart (m_last);
+          dt = time - m_anchor.time;
+          if (dt <= 0)
+            {
+              Emit (p);
+              Restart (p);
+              m_last = p;
+              m_lastWritten = true;
+              return;
+            }
+        }
+      m_upper = std::min (m_upper, (value + m_error - m_anchor.value) / dt);
+      m_lower = std::max (m_lower, (value - m_error - m_anchor.value) / dt);
+      m_last = p;
+      m_lastWritten = false;
+      return;
+    }
+  m_last = p;
+  m_lastWritten = true;
+}
+
+inline void
+CwndCompressor::Flush (void)
+{
+  if (m_mode == PIECEWISE_LINEAR)
+    {
+      if (m_started && !m_lastWritten)
+        {
+          Emit (m_last);
+          m_lastWritten = true;
+        }
+      m_os->flush ();
+      return;
+    }
+
+  std::vector<uint32_t> keep = Lttb (m_points, m_threshold);
+  std::vector<uint32_t> merged;
+  merged.reserve (keep.size () + m_markers.size ());
+  std::merge (keep.begin (), keep.end (), m_markers.begin (), m_markers.end (), std::back_inserter (merged));
+  merged.erase (std::unique (merged.begin (), merged.end ()), merged.end ());
+  for (std::vector<uint32_t>::const_iterator it = merged.begin (); it != merged.end (); ++it)
+    {
+      Emit (m_points[*it]);
+    }
+  m_points.clear ();
+  m_markers.clear ();
+  m_os->flush ();
+}
+
+inline std::vector<uint32_t>
+CwndCompressor::Lttb (const std::vector<Point> &points, uint32_t threshold)
+{
+  std::vector<uint32_t> selected;
+  uint32_t n = points.size ();
+  if (threshold >= n || threshold < 3)
+    {
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          selected.push_back (i);
+        }
+      return selected;
+    }
+
+  // The first and last points are kept; the rest is split into
+  // threshold - 2 buckets, and from each bucket the point forming the
+  // largest triangle with the previous selection and the average of the
+  // next bucket is chosen.
+  double every = double (n - 2) / (threshold - 2);
+  uint32_t a = 0;
+  selected.reserve (threshold);
+  selected.push_back (0);
+  for (uint32_t i = 0; i < threshold - 2; ++i)
+    {
+      uint32_t nextBegin = uint32_t ((i + 1) * every) + 1;
+      uint32_t nextEnd = std::min (uint32_t ((i + 2) * every) + 1, n);
+      double avgTime = 0;
+      double avgValue = 0;
+      for (uint32_t j = nextBegin; j < nextEnd; ++j)
+        {
+          avgTime += points[j].time;
+          avgValue += points[j].value;
+        }
+      avgTime /= (nextEnd - nextBegin);
+      avgValue /= (nextEnd - nextBegin);
+
+      uint32_t begin = uint32_t (i * every) + 1;
+      uint32_t end = nextBegin;
+      double maxArea = -1;
+      uint32_t chosen = begin;
+      for (uint32_t j = begin; j < end; ++j)
+        {
+          double area = std::fabs ((points[a].time - avgTime) * (points[j].value - points[a].value)
+                                   - (points[a].time - points[j].time) * (avgValue - points[a].value));
+          if (area > maxArea)
+            {
+              maxArea = area;
+              chosen = j;
+            }
+        }
+      selected.push_back (chosen);
+      a = chosen;
+    }
+  selected.push_back (n - 1);
+  return selected;
+}
+
+} // namespace ns3
+
+#endif /* CWND_COMPRESSOR_H */
@@ -0,0 +1,326 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DUMBBELL_BUILDER_H
+#define DUMBBELL_BUILDER_H
+
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ipv4-subnet-allocator.h"
+
+// ===========================================================================
+//
+// A dumbbell of N senders and M receivers around one bottleneck link:
+//
+//    left 0  --+                          +--  right 0
+//    left 1  --+-- left router -------- right router --+--  right 1
+//     ...    --+      (bottleneck link)   +--   ...
+//
+// All nodes are created with one NodeContainer::Create, in the order left
+// leaves, left router, right router, right leaves, so the six-node dumbbell
+// of the tcp-pacing scripts keeps its node ids.  Each link is installed
+// straight from the two nodes, without building a NodeContainer per link.
+//
+// AssignIpv4Addresses gives every link its own subnet from an
+// Ipv4SubnetAllocator, left links first, then the bottleneck, then right
+// links, all in one Assign call instead of a SetBase and an Assign of
+// Ipv4AddressHelper per link.
+//
+//   PointToPointHelper leafLink;
+//   PointToPointHelper bottleneckLink;
+//   ...
+//   DumbbellBuilder dumbbell (leafLink, bottleneckLink);
+//   dumbbell.Build (nSenders, nReceivers);
+//   InternetStackHelper stack;
+//   dumbbell.InstallStack (stack);
+//   Ipv4SubnetAllocator allocator ("10.1.0.0", "255.255.0.0");
+//   dumbbell.AssignIpv4Addresses (allocator);
+//   Address sinkAddress (InetSocketAddress (dumbbell.GetRightIpv4Address (0), 8080));
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Builds an N-sender, M-receiver dumbbell with bulk node, device
+ *        and address allocation.
+ */
+class DumbbellBuilder
+{
+public:
+  /**
+   * \param leafLink the helper used for the links of the leaves
+   * \param bottleneckLink the helper used for the link between the routers
+   */
+  DumbbellBuilder (const PointToPointHelper &leafLink, const PointToPointHelper &bottleneckLink);
+
+  /**
+   * Create the nodes and links.
+   * \param nLeft the number of leaves on the left (sender) side
+   * \param nRight the number of leaves on the right (receiver) side
+   */
+  void Build (uint32_t nLeft, uint32_t nRight);
+  /**
+   * \param stack the stack to install on every node of the dumbbell
+   */
+  void InstallStack (InternetStackHelper &stack);
+  /**
+   * Give every link the next subnet of \p allocator.
+   * \param allocator the allocator to take the subnets from
+   */
+  void AssignIpv4Addresses (Ipv4SubnetAllocator &allocator);
+  /**
+   * Give every link a subnet of \p mask, consecutively from \p base.
+   * \param base the network address of the first subnet
+   * \param mask the mask of each subnet
+   */
+  void AssignIpv4Addresses (Ipv4Address base, Ipv4Mask mask);
+
+  /**
+   * \return the number of left leaves
+   */
+  uint32_t GetNLeft (void) const;
+  /**
+   * \return the number of right leaves
+   */
+  uint32_t GetNRight (void) const;
+  /**
+   * \return all nodes, in the order left leaves, left router, right
+   *         router, right leaves
+   */
+  const NodeContainer &GetNodes (void) const;
+  /**
+   * \param i the index of the left leaf
+   * \return the node
+   */
+  Ptr<Node> GetLeft (uint32_t i) const;
+  /**
+   * \param i the index of the right leaf
+   * \return the node
+   */
+  Ptr<Node> GetRight (uint32_t i) const;
+  /**
+   * \return the router of the left side
+   */
+  Ptr<Node> GetLeftRouter (void) const;
+  /**
+   * \return the router of the right side
+   */
+  Ptr<Node> GetRightRouter (void) const;
+  /**
+   * \return the devices of the bottleneck link, left router's first
+   */
+  NetDeviceContainer GetBottleneckDevices (void) const;
+  /**
+   * \param i the index of the left leaf
+   * \return the device of the leaf on its link
+   */
+  Ptr<NetDevice> GetLeftDevice (uint32_t i) const;
+  /**
+   * \param i the index of the right leaf
+   * \return the device of the leaf on its link
+   */
+  Ptr<NetDevice> GetRightDevice (uint32_t i) const;
+  /**
+   * \param i the index of the left leaf
+   * \return the address of the leaf
+   */
+  Ipv4Address GetLeftIpv4Address (uint32_t i) const;
+  /**
+   * \param i the index of the right leaf
+   * \return the address of the leaf
+   */
+  Ipv4Address GetRightIpv4Address (uint32_t i) const;
+  /**
+   * \return the address of the left router on the bottleneck link
+   */
+  Ipv4Address GetLeftRouterIpv4Address (void) const;
+  /**
+   * \return the address of the right router on the bottleneck link
+   */
+  Ipv4Address GetRightRouterIpv4Address (void) const;
+
+private:
+  PointToPointHelper m_leafLink;
+  PointToPointHelper m_bottleneckLink;
+  uint32_t m_nLeft;
+  uint32_t m_nRight;
+  NodeContainer m_nodes;
+  // Link i has devices 2i and 2i + 1: left links (leaf, router), then the
+  // bottleneck (left router, right router), then right links (router, leaf).
+  std::vector<Ptr<NetDevice> > m_devices;
+  Ipv4InterfaceContainer m_interfaces;  //!< the interface of each device
+};
+
+inline
+DumbbellBuilder::DumbbellBuilder (const PointToPointHelper &leafLink, const PointToPointHelper &bottleneckLink)
+  : m_leafLink (leafLink),
+    m_bottleneckLink (bottleneckLink),
+    m_nLeft (0),
+    m_nRight (0)
+{
+}
+
+inline void
+DumbbellBuilder::Build (uint32_t nLeft, uint32_t nRight)
+{
+  NS_ASSERT_MSG (m_nodes.GetN () == 0, "DumbbellBuilder::Build called twice");
+  NS_ASSERT (nLeft > 0 && nRight > 0);
+  m_nLeft = nLeft;
+  m_nRight = nRight;
+  m_nodes.Create (nLeft + 2 + nRight);
+  m_devices.reserve (2 * (nLeft + 1 + nRight));
+
+  Ptr<Node> leftRouter = GetLeftRouter ();
+  Ptr<Node> rightRouter = GetRightRouter ();
+  for (uint32_t i = 0; i < nLeft; ++i)
+    {
+      NetDeviceContainer link = m_leafLink.Install (GetLeft (i), leftRouter);
+      m_devices.push_back (link.Get (0));
+      m_devices.push_back (link.Get (1));
+    }
+  NetDeviceContainer bottleneck = m_bottleneckLink.Install (leftRouter, rightRouter);
+  m_devices.push_back (bottleneck.Get (0));
+  m_devices.push_back (bottleneck.Get (1));
+  for (uint32_t i = 0; i < nRight; ++i)
+    {
+      NetDeviceContainer link = m_leafLink.Install (rightRouter, GetRight (i));
+      m_devices.push_back (link.Get (0));
+      m_devices.push_back (link.Get (1));
+    }
+}
+
+inline void
+DumbbellBuilder::InstallStack (InternetStackHelper &stack)
+{
+  stack.Install (m_nodes);
+}
+
+inline void
+DumbbellBuilder::AssignIpv4Addresses (Ipv4SubnetAllocator &allocator)
+{
+  NS_ASSERT_MSG (m_interfaces.GetN () == 0, "DumbbellBuilder::AssignIpv4Addresses called twice");
+  m_interfaces = allocator.Assign (m_devices.begin (), m_devices.end ());
+}
+
+inline void
+DumbbellBuilder::AssignIpv4Addresses (Ipv4Address base, Ipv4Mask mask)
+{
+  Ipv4SubnetAllocator allocator (base, Ipv4Mask::GetZero (), mask);
+  AssignIpv4Addresses (allocator);
+}
+
+inline uint32_t
+DumbbellBuilder::GetNLeft (void) const
+{
+  return m_nLeft;
+}
+
+inline uint32_t
+DumbbellBuilder::GetNRight (void) const
+{
+  return m_nRight;
+}
+
+inline const NodeContainer &
+DumbbellBuilder::GetNodes (void) const
+{
+  return m_nodes;
+}
+
+inline Ptr<Node>
+DumbbellBuilder::GetLeft (uint32_t i) const
+{
+  NS_ASSERT (i < m_nLeft);
+  return m_nodes.Get (i);
+}
+
+inline Ptr<Node>
+DumbbellBuilder::GetRight (uint32_t i) const
+{
+  NS_ASSERT (i < m_nRight);
+  return m_nodes.Get (m_nLeft + 2 + i);
+}
+
+inline Ptr<Node>
+DumbbellBuilder::GetLeftRouter (void) const
+{
+  return m_nodes.Get (m_nLeft);
+}
+
+inline Ptr<Node>
+DumbbellBuilder::GetRightRouter (void) const
+{
+  return m_nodes.Get (m_nLeft + 1);
+}
+
+inline NetDeviceContainer
+DumbbellBuilder::GetBottleneckDevices (void) const
+{
+  NetDeviceContainer devices (m_devices[2 * m_nLeft]);
+  devices.Add (m_devices[2 * m_nLeft + 1]);
+  return devices;
+}
+
+inline Ptr<NetDevice>
+DumbbellBuilder::GetLeftDevice (uint32_t i) const
+{
+  NS_ASSERT (i < m_nLeft);
+  return m_devices[2 * i];
+}
+
+inline Ptr<NetDevice>
+DumbbellBuilder::GetRightDevice (uint32_t i) const
+{
+  NS_ASSERT (i < m_nRight);
+  return m_devices[2 * (m_nLeft + 1 + i) + 1];
+}
+
+inline Ipv4Address
+DumbbellBuilder::GetLeftIpv4Address (uint32_t i) const
+{
+  NS_ASSERT_MSG (i < m_nLeft && m_interfaces.GetN () > 0, "No address assigned to left leaf " << i);
+  return m_interfaces.GetAddress (2 * i);
+}
+
+inline Ipv4Address
+DumbbellBuilder::GetRightIpv4Address (uint32_t i) const
+{
+  NS_ASSERT_MSG (i < m_nRight && m_interfaces.GetN () > 0, "No address assigned to right leaf " << i);
+  return m_interfaces.GetAddress (2 * (m_nLeft + 1 + i) + 1);
+}
+
+inline Ipv4Address
+DumbbellBuilder::GetLeftRouterIpv4Address (void) const
+{
+  NS_ASSERT (m_interfaces.GetN () > 0);
+  return m_interfaces.GetAddress (2 * m_nLeft);
+}
+
+inline Ipv4Address
+DumbbellBuilder::GetRightRouterIpv4Address (void) const
+{
+  NS_ASSERT (m_interfaces.GetN () > 0);
+  return m_interfaces.GetAddress (2 * m_nLeft + 1);
+}
+
+} // namespace ns3
+
+#endif /* DUMBBELL_BUILDER_H */
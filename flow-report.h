@@ -0,0 +1,646 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_REPORT_H
+#define FLOW_REPORT_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "flow-table-monitor.h"
+
+// ===========================================================================
+//
+// The post-run flow summary of the scripts, computed once for all flows.
+// The statistics are copied into one column per field (structure of
+// arrays); Compute then derives the per-flow metrics and the aggregates in
+// a single pass over the columns, split across threads for large runs:
+//
+//   per flow    PDR, loss ratio, mean delay, mean jitter, throughput
+//   aggregate   packet and byte totals, PDR, loss ratio, mean delay and
+//               jitter over all packets, total and mean throughput, and
+//               Jain's fairness index of the flow throughputs
+//
+// Aggregates are given for all flows and for each class set by GroupBy.
+// All ratios are computed in floating point.  The report is printed, or
+// written as CSV or JSON, from one buffer in one write.
+//
+//   FlowReport report;
+//   report.SetUnit (1e6, "Mbps");
+//   report.AddAll (monitor, classifier);
+//   report.GroupBy ([] (const FlowReport::FiveTuple &t) {
+//     return t.destinationPort == 8080 ? "data" : "ack"; });
+//   report.Compute ();
+//   report.Print (std::cout);
+//   report.WriteCsv ("flows.csv");
+//
+// Throughput is measured from the first sent to the last received packet
+// of each flow, unless SetDuration gives one duration for all flows.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Per-flow and aggregate metrics of a set of flows.
+ */
+class FlowReport
+{
+public:
+  /// The five-tuple of a flow.
+  typedef FlowTableMonitor::FiveTuple FiveTuple;
+
+  /// The aggregate metrics of a group of flows.
+  struct Summary
+  {
+    std::string name;      //!< "all" or the class name
+    uint32_t flows;        //!< number of flows
+    uint64_t txPackets;    //!< packets sent
+    uint64_t rxPackets;    //!< packets received
+    uint64_t lostPackets;  //!< packets sent but not received
+    uint64_t txBytes;      //!< bytes sent
+    uint64_t rxBytes;      //!< bytes received
+    double pdr;            //!< received / sent packets
+    double lossRatio;      //!< lost / sent packets
+    double meanDelay;      //!< mean delay of all received packets in seconds
+    double meanJitter;     //!< mean jitter of all received packets in seconds
+    double throughput;     //!< sum of the flow throughputs, in the unit
+    double meanThroughput; //!< mean flow throughput, in the unit
+    double fairness;       //!< Jain's fairness index of the flow throughputs
+  };
+
+  FlowReport ();
+
+  /**
+   * \param bitsPerUnit bit/s per throughput unit, e.g. 1e6
+   * \param name the unit name, e.g. "Mbps"
+   */
+  void SetUnit (double bitsPerUnit, std::string name);
+  /**
+   * \param duration the time over which every flow's throughput is taken;
+   *        zero for each flow's own first-sent to last-received time
+   */
+  void SetDuration (Time duration);
+  /**
+   * \param threads the threads Compute may use; 0 for one per core
+   */
+  void SetThreads (uint32_t threads);
+
+  /**
+   * \param n the number of flows about to be added
+   */
+  void Reserve (uint32_t n);
+  /**
+   * Add one flow.  Works with the stats and five-tuples of FlowMonitor
+   * and of FlowTableMonitor.
+   * \param id the flow
+   * \param tuple its five-tuple
+   * \param stats its statistics
+   */
+  template <typename Tuple, typename Stats>
+  void Add (FlowId id, const Tuple &tuple, const Stats &stats);
+  /**
+   * Add every flow of a FlowMonitor.
+   * \param monitor the monitor
+   * \param classifier its classifier
+   */
+  void AddAll (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier);
+  /**
+   * Add every flow of a FlowTableMonitor.
+   * \param monitor the monitor
+   */
+  void AddAll (Ptr<FlowTableMonitor> monitor);
+
+  /**
+   * Put every flow into the class named by \p classOf (tuple).
+   * \param classOf returns a class name for a five-tuple
+   */
+  template <typename Classifier>
+  void GroupBy (Classifier classOf);
+
+  /**
+   * Compute the per-flow metrics and the summaries.
+   */
+  void Compute (void);
+
+  /**
+   * \return the number of flows
+   */
+  uint32_t GetN (void) const;
+  /**
+   * \return the summary of all flows
+   */
+  const Summary &GetTotal (void) const;
+  /**
+   * \return the summaries of the classes, in order of first appearance
+   */
+  const std::vector<Summary> &GetClasses (void) const;
+  /**
+   * \param i a flow index, in the order added
+   * \return the throughput of the flow, in the unit
+   */
+  double GetThroughput (uint32_t i) const;
+
+  /**
+   * Print one line per flow and the summaries.
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+  /**
+   * Write one CSV row per flow.
+   * \param filename the output file
+   */
+  void WriteCsv (std::string filename) const;
+  /**
+   * Write the flows and summaries as JSON.
+   * \param filename the output file
+   */
+  void WriteJson (std::string filename) const;
+
+private:
+  /// Running sums of a group of flows.
+  struct Accumulator
+  {
+    uint32_t flows;
+    uint64_t txPackets;
+    uint64_t rxPackets;
+    uint64_t lostPackets;
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    double delaySum;
+    double jitterSum;
+    uint64_t jitterSamples;
+    double throughput;
+    double throughputSquares;
+  };
+
+  void ComputeRange (uint32_t begin, uint32_t end, std::vector<Accumulator> *sums);
+  static Summary Summarize (std::string name, const Accumulator &sum);
+  static void Append (std::string &out, const char *format, ...);
+  static std::string EscapeJson (const std::string &text);
+  void AppendSummary (std::string &out, const Summary &s) const;
+  static void WriteFile (std::string filename, const std::string &content);
+
+  double                   m_unit;
+  std::string              m_unitName;
+  double                   m_duration;
+  uint32_t                 m_threads;
+
+  // Input columns, one entry per flow
+  std::vector<uint32_t>    m_flowId;
+  std::vector<FiveTuple>   m_tuple;
+  std::vector<uint32_t>    m_txPackets;
+  std::vector<uint32_t>    m_rxPackets;
+  std::vector<uint64_t>    m_txBytes;
+  std::vector<uint64_t>    m_rxBytes;
+  std::vector<double>      m_delaySum;   //!< seconds
+  std::vector<double>      m_jitterSum;  //!< seconds
+  std::vector<double>      m_firstTx;    //!< seconds
+  std::vector<double>      m_lastRx;     //!< seconds
+  std::vector<uint32_t>    m_class;      //!< class index + 1, 0 for none
+  std::vector<std::string> m_classNames;
+
+  // Output columns
+  std::vector<double>      m_pdr;
+  std::vector<double>      m_lossRatio;
+  std::vector<double>      m_meanDelay;
+  std::vector<double>      m_meanJitter;
+  std::vector<double>      m_throughput;
+  Summary                  m_total;
+  std::vector<Summary>     m_classes;
+};
+
+inline
+FlowReport::FlowReport ()
+  : m_unit (1e6),
+    m_unitName ("Mbps"),
+    m_duration (0),
+    m_threads (0)
+{
+  m_total = Summarize ("all", Accumulator ());
+}
+
+inline void
+FlowReport::SetUnit (double bitsPerUnit, std::string name)
+{
+  m_unit = bitsPerUnit;
+  m_unitName = name;
+}
+
+inline void
+FlowReport::SetDuration (Time duration)
+{
+  m_duration = duration.GetSeconds ();
+}
+
+inline void
+FlowReport::SetThreads (uint32_t threads)
+{
+  m_threads = threads;
+}
+
+inline void
+FlowReport::Reserve (uint32_t n)
+{
+  m_flowId.reserve (n);
+  m_tuple.reserve (n);
+  m_txPackets.reserve (n);
+  m_rxPackets.reserve (n);
+  m_txBytes.reserve (n);
+  m_rxBytes.reserve (n);
+  m_delaySum.reserve (n);
+  m_jitterSum.reserve (n);
+  m_firstTx.reserve (n);
+  m_lastRx.reserve (n);
+  m_class.reserve (n);
+}
+
+template <typename Tuple, typename Stats>
+void
+FlowReport::Add (FlowId id, const Tuple &tuple, const Stats &stats)
+{
+  FiveTuple t;
+  t.sourceAddress = tuple.sourceAddress;
+  t.destinationAddress = tuple.destinationAddress;
+  t.protocol = tuple.protocol;
+  t.sourcePort = tuple.sourcePort;
+  t.destinationPort = tuple.destinationPort;
+  m_flowId.push_back (id);
+  m_tuple.push_back (t);
+  m_txPackets.push_back (stats.txPackets);
+  m_rxPackets.push_back (stats.rxPackets);
+  m_txBytes.push_back (stats.txBytes);
+  m_rxBytes.push_back (stats.rxBytes);
+  m_delaySum.push_back (stats.delaySum.GetSeconds ());
+  m_jitterSum.push_back (stats.jitterSum.GetSeconds ());
+  m_firstTx.push_back (stats.timeFirstTxPacket.GetSeconds ());
+  m_lastRx.push_back (stats.timeLastRxPacket.GetSeconds ());
+  m_class.push_back (0);
+}
+
+inline void
+FlowReport::AddAll (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+{
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+  Reserve (m_flowId.size () + stats.size ());
+  for (FlowMonitor::FlowStatsContainerCI it = stats.begin (); it != stats.end (); ++it)
+    {
+      Add (it->first, classifier->FindFlow (it->first), it->second);
+    }
+}
+
+inline void
+FlowReport::AddAll (Ptr<FlowTableMonitor> monitor)
+{
+  Reserve (m_flowId.size () + monitor->GetNFlows ());
+  for (FlowId id = 1; id <= monitor->GetNFlows (); ++id)
+    {
+      Add (id, monitor->GetFiveTuple (id), monitor->GetStats (id));
+    }
+}
+
+template <typename Classifier>
+void
+FlowReport::GroupBy (Classifier classOf)
+{
+  std::map<std::string, uint32_t> index;
+  m_classNames.clear ();
+  for (uint32_t i = 0; i < m_tuple.size (); ++i)
+    {
+      std::string name = classOf (m_tuple[i]);
+      std::map<std::string, uint32_t>::iterator it = index.find (name);
+      if (it == index.end ())
+        {
+          m_classNames.push_back (name);
+          it = index.insert (std::make_pair (name, m_classNames.size ())).first;
+        }
+      m_class[i] = it->second;
+    }
+}
+
+inline void
+FlowReport::ComputeRange (uint32_t begin, uint32_t end, std::vector<Accumulator> *sums)
+{
+  // (*sums)[0] collects all flows, (*sums)[c] the flows of class c.
+  for (uint32_t i = begin; i < end; ++i)
+    {
+      double tx = m_txPackets[i];
+      double rx = m_rxPackets[i];
+      uint64_t lost = m_txPackets[i] > m_rxPackets[i] ? m_txPackets[i] - m_rxPackets[i] : 0;
+      double duration = m_duration > 0 ? m_duration : m_lastRx[i] - m_firstTx[i];
+      double throughput = duration > 0 ? m_rxBytes[i] * 8.0 / duration / m_unit : 0;
+      m_pdr[i] = tx > 0 ? rx / tx : 0;
+      m_lossRatio[i] = tx > 0 ? lost / tx : 0;
+      m_meanDelay[i] = rx > 0 ? m_delaySum[i] / rx : 0;
+      m_meanJitter[i] = rx > 1 ? m_jitterSum[i] / (rx - 1) : 0;
+      m_throughput[i] = throughput;
+
+      uint32_t groups[2] = { 0, m_class[i] };
+      for (uint32_t g = 0; g < (m_class[i] != 0 ? 2u : 1u); ++g)
+        {
+          Accumulator &sum = (*sums)[groups[g]];
+          sum.flows++;
+          sum.txPackets += m_txPackets[i];
+          sum.rxPackets += m_rxPackets[i];
+          sum.lostPackets += lost;
+          sum.txBytes += m_txBytes[i];
+          sum.rxBytes += m_rxBytes[i];
+          sum.delaySum += m_delaySum[i];
+          sum.jitterSum += m_jitterSum[i];
+          sum.jitterSamples += m_rxPackets[i] > 1 ? m_rxPackets[i] - 1 : 0;
+          sum.throughput += throughput;
+          sum.throughputSquares += throughput * throughput;
+        }
+    }
+}
+
+inline FlowReport::Summary
+FlowReport::Summarize (std::string name, const Accumulator &sum)
+{
+  Summary s;
+  s.name = name;
+  s.flows = sum.flows;
+  s.txPackets = sum.txPackets;
+  s.rxPackets = sum.rxPackets;
+  s.lostPackets = sum.lostPackets;
+  s.txBytes = sum.txBytes;
+  s.rxBytes = sum.rxBytes;
+  s.pdr = sum.txPackets > 0 ? double (sum.rxPackets) / sum.txPackets : 0;
+  s.lossRatio = sum.txPackets > 0 ? double (sum.lostPackets) / sum.txPackets : 0;
+  s.meanDelay = sum.rxPackets > 0 ? sum.delaySum / sum.rxPackets : 0;
+  s.meanJitter = sum.jitterSamples > 0 ? sum.jitterSum / sum.jitterSamples : 0;
+  s.throughput = sum.throughput;
+  s.meanThroughput = sum.flows > 0 ? sum.throughput / sum.flows : 0;
+  // Jain's index: (sum x)^2 / (n sum x^2), 1 when all flows are equal
+  s.fairness = sum.throughputSquares > 0 ? sum.throughput * sum.throughput / (sum.flows * sum.throughputSquares) : 0;
+  return s;
+}
+
+inline void
+FlowReport::Compute (void)
+{
+  uint32_t n = m_flowId.size ();
+  m_pdr.resize (n);
+  m_lossRatio.resize (n);
+  m_meanDelay.resize (n);
+  m_meanJitter.resize (n);
+  m_throughput.resize (n);
+
+  // Threads only pay off with many flows; each takes a contiguous range
+  // and its own sums, which are added up at the end.
+  const uint32_t minPerThread = 16384;
+  uint32_t threads = m_threads > 0 ? m_threads : std::max (1u, std::thread::hardware_concurrency ());
+  threads = std::max (1u, std::min (threads, n / minPerThread));
+
+  Accumulator zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  std::vector<std::vector<Accumulator> > sums (threads, std::vector<Accumulator> (m_classNames.size () + 1, zero));
+  std::vector<std::thread> workers;
+  uint32_t chunk = (n + threads - 1) / threads;
+  for (uint32_t t = 1; t < threads; ++t)
+    {
+      workers.push_back (std::thread (&FlowReport::ComputeRange, this,
+                                      std::min (n, t * chunk), std::min (n, (t + 1) * chunk), &sums[t]));
+    }
+  ComputeRange (0, std::min (n, chunk), &sums[0]);
+  for (uint32_t t = 0; t < workers.size (); ++t)
+    {
+      workers[t].join ();
+    }
+
+  for (uint32_t t = 1; t < threads; ++t)
+    {
+      for (uint32_t c = 0; c < sums[0].size (); ++c)
+        {
+          Accumulator &to = sums[0][c];
+          const Accumulator &from = sums[t][c];
+          to.flows += from.flows;
+          to.txPackets += from.txPackets;
+          to.rxPackets += from.rxPackets;
+          to.lostPackets += from.lostPackets;
+          to.txBytes += from.txBytes;
+          to.rxBytes += from.rxBytes;
+          to.delaySum += from.delaySum;
+          to.jitterSum += from.jitterSum;
+          to.jitterSamples += from.jitterSamples;
+          to.throughput += from.throughput;
+          to.throughputSquares += from.throughputSquares;
+        }
+    }
+  m_total = Summarize ("all", sums[0][0]);
+  m_classes.clear ();
+  for (uint32_t c = 0; c < m_classNames.size (); ++c)
+    {
+      m_classes.push_back (Summarize (m_classNames[c], sums[0][c + 1]));
+    }
+}
+
+inline uint32_t
+FlowReport::GetN (void) const
+{
+  return m_flowId.size ();
+}
+
+inline const FlowReport::Summary &
+FlowReport::GetTotal (void) const
+{
+  return m_total;
+}
+
+inline const std::vector<FlowReport::Summary> &
+FlowReport::GetClasses (void) const
+{
+  return m_classes;
+}
+
+inline double
+FlowReport::GetThroughput (uint32_t i) const
+{
+  NS_ASSERT (i < m_throughput.size ());
+  return m_throughput[i];
+}
+
+inline void
+FlowReport::Append (std::string &out, const char *format, ...)
+{
+  char line[512];
+  va_list args;
+  va_start (args, format);
+  int n = std::vsnprintf (line, sizeof (line), format, args);
+  va_end (args);
+  if (n < 0)
+    {
+      NS_FATAL_ERROR ("FlowReport cannot format \"" << format << "\"");
+    }
+  if (n < int (sizeof (line)))
+    {
+      out.append (line, n);
+      return;
+    }
+
+  // A long line, e.g. with a long class name: format it again straight
+  // into its place at the end of out.
+  std::string::size_type end = out.size ();
+  out.resize (end + n + 1);
+  va_start (args, format);
+  std::vsnprintf (&out[end], n + 1, format, args);
+  va_end (args);
+  out.resize (end + n);
+}
+
+inline std::string
+FlowReport::EscapeJson (const std::string &text)
+{
+  std::string escaped;
+  escaped.reserve (text.size ());
+  for (std::string::const_iterator it = text.begin (); it != text.end (); ++it)
+    {
+      unsigned char c = *it;
+      if (c == '"' || c == '\\')
+        {
+          escaped += '\\';
+          escaped += c;
+        }
+      else if (c < 0x20)
+        {
+          char code[8];
+          std::snprintf (code, sizeof (code), "\\u%04x", c);
+          escaped += code;
+        }
+      else
+        {
+          escaped += c;
+        }
+    }
+  return escaped;
+}
+
+inline void
+FlowReport::AppendSummary (std::string &out, const Summary &s) const
+{
+  Append (out, "%s: %u flows, sent %llu, received %llu, lost %llu packets\n",
+          s.name.c_str (), s.flows, (unsigned long long) s.txPackets,
+          (unsigned long long) s.rxPackets, (unsigned long long) s.lostPackets);
+  Append (out, "  PDR %.2f%%, loss %.2f%%, delay %.3f ms, jitter %.3f ms\n",
+          100 * s.pdr, 100 * s.lossRatio, 1e3 * s.meanDelay, 1e3 * s.meanJitter);
+  Append (out, "  throughput %.3f %s total, %.3f %s per flow, Jain fairness %.4f\n",
+          s.throughput, m_unitName.c_str (), s.meanThroughput, m_unitName.c_str (), s.fairness);
+}
+
+inline void
+FlowReport::Print (std::ostream &os) const
+{
+  std::string out;
+  out.reserve (160 * (m_flowId.size () + 8));
+  for (uint32_t i = 0; i < m_flowId.size (); ++i)
+    {
+      std::ostringstream src;
+      std::ostringstream dst;
+      src << m_tuple[i].sourceAddress << ':' << m_tuple[i].sourcePort;
+      dst << m_tuple[i].destinationAddress << ':' << m_tuple[i].destinationPort;
+      Append (out, "Flow %u %s -> %s: sent %u, received %u, PDR %.2f%%, delay %.3f ms, jitter %.3f ms, %.3f %s\n",
+              m_flowId[i], src.str ().c_str (), dst.str ().c_str (), m_txPackets[i], m_rxPackets[i],
+              100 * m_pdr[i], 1e3 * m_meanDelay[i], 1e3 * m_meanJitter[i], m_throughput[i], m_unitName.c_str ());
+    }
+  AppendSummary (out, m_total);
+  for (uint32_t c = 0; c < m_classes.size (); ++c)
+    {
+      AppendSummary (out, m_classes[c]);
+    }
+  os.write (out.data (), out.size ());
+  os.flush ();
+}
+
+inline void
+FlowReport::WriteFile (std::string filename, const std::string &content)
+{
+  std::FILE *file = std::fopen (filename.c_str (), "w");
+  if (file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open report file " << filename);
+    }
+  std::fwrite (content.data (), 1, content.size (), file);
+  std::fclose (file);
+}
+
+inline void
+FlowReport::WriteCsv (std::string filename) const
+{
+  std::string out;
+  out.reserve (160 * (m_flowId.size () + 1));
+  Append (out, "flow,class,source,sourcePort,destination,destinationPort,protocol,"
+          "txPackets,rxPackets,txBytes,rxBytes,pdr,lossRatio,meanDelay,meanJitter,throughput\n");
+  for (uint32_t i = 0; i < m_flowId.size (); ++i)
+    {
+      std::ostringstream src;
+      std::ostringstream dst;
+      src << m_tuple[i].sourceAddress;
+      dst << m_tuple[i].destinationAddress;
+      Append (out, "%u,%s,%s,%u,%s,%u,%u,%u,%u,%llu,%llu,%.6f,%.6f,%.9f,%.9f,%.6f\n",
+              m_flowId[i], m_class[i] != 0 ? m_classNames[m_class[i] - 1].c_str () : "",
+              src.str ().c_str (), unsigned (m_tuple[i].sourcePort),
+              dst.str ().c_str (), unsigned (m_tuple[i].destinationPort), unsigned (m_tuple[i].protocol),
+              m_txPackets[i], m_rxPackets[i], (unsigned long long) m_txBytes[i], (unsigned long long) m_rxBytes[i],
+              m_pdr[i], m_lossRatio[i], m_meanDelay[i], m_meanJitter[i], m_throughput[i]);
+    }
+  WriteFile (filename, out);
+}
+
+inline void
+FlowReport::WriteJson (std::string filename) const
+{
+  std::string out;
+  out.reserve (220 * (m_flowId.size () + m_classes.size () + 2));
+  Append (out, "{\n  \"unit\": \"%s\",\n  \"flows\": [", EscapeJson (m_unitName).c_str ());
+  for (uint32_t i = 0; i < m_flowId.size (); ++i)
+    {
+      std::ostringstream src;
+      std::ostringstream dst;
+      src << m_tuple[i].sourceAddress;
+      dst << m_tuple[i].destinationAddress;
+      Append (out, "%s\n    {\"flow\": %u, \"source\": \"%s:%u\", \"destination\": \"%s:%u\", "
+              "\"txPackets\": %u, \"rxPackets\": %u, \"pdr\": %.6f, \"meanDelay\": %.9f, "
+              "\"meanJitter\": %.9f, \"throughput\": %.6f}",
+              i > 0 ? "," : "", m_flowId[i], src.str ().c_str (), unsigned (m_tuple[i].sourcePort),
+              dst.str ().c_str (), unsigned (m_tuple[i].destinationPort),
+              m_txPackets[i], m_rxPackets[i], m_pdr[i], m_meanDelay[i], m_meanJitter[i], m_throughput[i]);
+    }
+  out += "\n  ],\n  \"summaries\": [";
+  for (uint32_t c = 0; c <= m_classes.size (); ++c)
+    {
+      const Summary &s = c == 0 ? m_total : m_classes[c - 1];
+      Append (out, "%s\n    {\"name\": \"%s\", \"flows\": %u, \"txPackets\": %llu, \"rxPackets\": %llu, "
+              "\"lostPackets\": %llu, \"pdr\": %.6f, \"lossRatio\": %.6f, \"meanDelay\": %.9f, "
+              "\"meanJitter\": %.9f, \"throughput\": %.6f, \"meanThroughput\": %.6f, \"fairness\": %.6f}",
+              c > 0 ? "," : "", EscapeJson (s.name).c_str (), s.flows, (unsigned long long) s.txPackets,
+              (unsigned long long) s.rxPackets, (unsigned long long) s.lostPackets, s.pdr, s.lossRatio,
+              s.meanDelay, s.meanJitter, s.throughput, s.meanThroughput, s.fairness);
+    }
+  out += "\n  ]\n}\n";
+  WriteFile (filename, out);
+}
+
+} // namespace ns3
+
+#endif /* FLOW_REPORT_H */
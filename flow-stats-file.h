@@ -0,0 +1,652 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_STATS_FILE_H
+#define FLOW_STATS_FILE_H
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/flow-monitor-module.h"
+
+// ===========================================================================
+//
+// A binary replacement for FlowMonitor::SerializeToXmlFile.  The XML writer
+// builds the whole document in one stream before writing it, and reading it
+// back means parsing text.  FlowStatsWriter writes one length-prefixed
+// record per flow straight to the file as it goes, and FlowStatsReader
+// reads the records back one at a time:
+//
+//   FlowStatsWriter::Write (monitor, classifier, "run.flowbin");
+//
+//   FlowStatsReader reader ("run.flowbin");
+//   FlowStatsRecord flow;
+//   while (reader.Next (flow))
+//     {
+//       ... flow.txPackets, flow.delayHistogram.counts, ...
+//     }
+//
+// The file is an 8-byte magic "NS3FLOW", a 32-bit version and a 32-bit
+// flags word, followed by records of a one-byte type, the payload length
+// and the payload.  Readers skip record types they do not know.  With
+// COMPACT set, every integer, including the lengths, is a LEB128 varint,
+// signed ones zigzag encoded, and histograms keep only their non-empty bins;
+// this usually makes the file several times smaller than the fixed 64-bit
+// encoding.  trace-convert --flowstats=<file> prints a file as text.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief The bins of a FlowMonitor histogram.
+ */
+struct FlowStatsHistogram
+{
+  double binWidth;              //!< width of every bin
+  std::vector<uint32_t> counts; //!< count of each bin, from 0
+};
+
+/**
+ * \brief The statistics of one flow, as stored in a flow statistics file.
+ */
+struct FlowStatsRecord
+{
+  uint32_t flowId;            //!< the flow
+  uint32_t sourceAddress;     //!< source address
+  uint32_t destinationAddress; //!< destination address
+  uint8_t protocol;           //!< IP protocol number
+  uint16_t sourcePort;        //!< source port
+  uint16_t destinationPort;   //!< destination port
+  int64_t timeFirstTxPacket;  //!< in nanoseconds
+  int64_t timeFirstRxPacket;  //!< in nanoseconds
+  int64_t timeLastTxPacket;   //!< in nanoseconds
+  int64_t timeLastRxPacket;   //!< in nanoseconds
+  int64_t delaySum;           //!< in nanoseconds
+  int64_t jitterSum;          //!< in nanoseconds
+  int64_t lastDelay;          //!< in nanoseconds
+  uint64_t txBytes;           //!< bytes sent
+  uint64_t rxBytes;           //!< bytes received
+  uint32_t txPackets;         //!< packets sent
+  uint32_t rxPackets;         //!< packets received
+  uint32_t lostPackets;       //!< packets lost
+  uint32_t timesForwarded;    //!< forwarding hops
+  std::vector<uint32_t> packetsDropped; //!< packets dropped, per drop reason
+  std::vector<uint64_t> bytesDropped;   //!< bytes dropped, per drop reason
+  FlowStatsHistogram delayHistogram;             //!< delay in seconds
+  FlowStatsHistogram jitterHistogram;            //!< jitter in seconds
+  FlowStatsHistogram packetSizeHistogram;        //!< packet size in bytes
+  FlowStatsHistogram flowInterruptionsHistogram; //!< interruption length in seconds
+};
+
+/**
+ * \brief Writes flow statistics to a binary file, one flow at a time.
+ */
+class FlowStatsWriter
+{
+public:
+  /// File flags.
+  enum Flags
+  {
+    COMPACT = 1,   //!< varint integers and sparse histograms
+    HISTOGRAMS = 2 //!< histograms and drop counters are written
+  };
+
+  FlowStatsWriter ();
+  ~FlowStatsWriter ();
+
+  /**
+   * Write every flow of \p monitor to \p filename.
+   * \param monitor the monitor
+   * \param classifier its classifier
+   * \param filename the output file
+   * \param flags a combination of Flags
+   * \return the number of flows written
+   */
+  static uint32_t Write (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier,
+                         std::string filename, uint32_t flags = COMPACT | HISTOGRAMS);
+
+  /**
+   * Create \p filename and write the file header.
+   * \param filename the output file
+   * \param flags a combination of Flags
+   */
+  void Open (std::string filename, uint32_t flags = COMPACT | HISTOGRAMS);
+  /**
+   * Append one flow.
+   * \param id the flow
+   * \param tuple its five-tuple
+   * \param stats its statistics
+   */
+  void Add (FlowId id, const Ipv4FlowClassifier::FiveTuple &tuple, const FlowMonitor::FlowStats &stats);
+  /**
+   * Close the file.
+   */
+  void Close (void);
+
+private:
+  FlowStatsWriter (const FlowStatsWriter &);
+  FlowStatsWriter &operator= (const FlowStatsWriter &);
+
+  void PutUnsigned (uint64_t v);
+  void PutSigned (int64_t v);
+  void PutDouble (double v);
+  void PutHistogram (const Histogram &histogram);
+
+  std::FILE            *m_file;
+  uint32_t              m_flags;
+  std::vector<uint8_t>  m_record;  //!< the payload being built, reused
+};
+
+/**
+ * \brief Reads a flow statistics file written by FlowStatsWriter.
+ */
+class FlowStatsReader
+{
+public:
+  /**
+   * \param filename the file to read
+   */
+  explicit FlowStatsReader (std::string filename);
+  ~FlowStatsReader ();
+
+  /**
+   * Read the next flow.
+   * \param record filled with the flow
+   * \return false at the end of the file
+   */
+  bool Next (FlowStatsRecord &record);
+
+  /**
+   * Read a whole file.
+   * \param filename the file
+   * \return all flows in it
+   */
+  static std::vector<FlowStatsRecord> Load (std::string filename);
+  /**
+   * Print a file as text, one line per flow.
+   * \param filename the file
+   * \param os the output stream
+   * \return the number of flows
+   */
+  static uint32_t Print (std::string filename, std::ostream &os);
+
+private:
+  FlowStatsReader (const FlowStatsReader &);
+  FlowStatsReader &operator= (const FlowStatsReader &);
+
+  bool ReadLength (uint64_t &v);
+  uint64_t GetUnsigned (void);
+  int64_t GetSigned (void);
+  double GetDouble (void);
+  void GetHistogram (FlowStatsHistogram &histogram);
+
+  std::FILE            *m_file;
+  std::string           m_name;
+  uint32_t              m_flags;
+  std::vector<uint8_t>  m_record;
+  size_t                m_pos;
+};
+
+/// Record types of a flow statistics file.
+enum FlowStatsRecordType
+{
+  FLOW_STATS_FLOW = 1
+};
+
+/// Version of the flow statistics file format.
+static const uint32_t FLOW_STATS_FILE_VERSION = 1;
+
+inline
+FlowStatsWriter::FlowStatsWriter ()
+  : m_file (0),
+    m_flags (0)
+{
+}
+
+inline
+FlowStatsWriter::~FlowStatsWriter ()
+{
+  Close ();
+}
+
+inline uint32_t
+FlowStatsWriter::Write (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier,
+                        std::string filename, uint32_t flags)
+{
+  FlowStatsWriter writer;
+  writer.Open (filename, flags);
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainerCI it = stats.begin (); it != stats.end (); ++it)
+    {
+      writer.Add (it->first, classifier->FindFlow (it->first), it->second);
+    }
+  writer.Close ();
+  return stats.size ();
+}
+
+inline void
+FlowStatsWriter::Open (std::string filename, uint32_t flags)
+{
+  Close ();
+  m_file = std::fopen (filename.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open flow statistics file " << filename);
+    }
+  m_flags = flags;
+  char magic[8] = "NS3FLOW";
+  uint32_t version = FLOW_STATS_FILE_VERSION;
+  std::fwrite (magic, sizeof (magic), 1, m_file);
+  std::fwrite (&version, sizeof (version), 1, m_file);
+  std::fwrite (&m_flags, sizeof (m_flags), 1, m_file);
+}
+
+inline void
+FlowStatsWriter::Close (void)
+{
+  if (m_file != 0)
+    {
+      std::fclose (m_file);
+      m_file = 0;
+    }
+}
+
+inline void
+FlowStatsWriter::PutUnsigned (uint64_t v)
+{
+  if (m_flags & COMPACT)
+    {
+      while (v >= 0x80)
+        {
+          m_record.push_back (uint8_t (v) | 0x80);
+          v >>= 7;
+        }
+      m_record.push_back (uint8_t (v));
+    }
+  else
+    {
+      for (int i = 0; i < 8; ++i)
+        {
+          m_record.push_back (uint8_t (v >> (8 * i)));
+        }
+    }
+}
+
+inline void
+FlowStatsWriter::PutSigned (int64_t v)
+{
+  PutUnsigned ((uint64_t (v) << 1) ^ uint64_t (v >> 63));
+}
+
+inline void
+FlowStatsWriter::PutDouble (double v)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &v, sizeof (bits));
+  for (int i = 0; i < 8; ++i)
+    {
+      m_record.push_back (uint8_t (bits >> (8 * i)));
+    }
+}
+
+inline void
+FlowStatsWriter::PutHistogram (const Histogram &histogram)
+{
+  uint32_t bins = histogram.GetNBins ();
+  PutDouble (bins > 0 ? histogram.GetBinWidth (0) : 0);
+  PutUnsigned (bins);
+  if (m_flags & COMPACT)
+    {
+      // Only the non-empty bins, as (gap to the previous one, count)
+      uint32_t nonEmpty = 0;
+      for (uint32_t i = 0; i < bins; ++i)
+        {
+          nonEmpty += histogram.GetBinCount (i) != 0;
+        }
+      PutUnsigned (nonEmpty);
+      uint32_t previous = 0;
+      for (uint32_t i = 0; i < bins; ++i)
+        {
+          if (histogram.GetBinCount (i) != 0)
+            {
+              PutUnsigned (i - previous);
+              PutUnsigned (histogram.GetBinCount (i));
+              previous = i;
+            }
+        }
+    }
+  else
+    {
+      for (uint32_t i = 0; i < bins; ++i)
+        {
+          PutUnsigned (histogram.GetBinCount (i));
+        }
+    }
+}
+
+inline void
+FlowStatsWriter::Add (FlowId id, const Ipv4FlowClassifier::FiveTuple &tuple, const FlowMonitor::FlowStats &stats)
+{
+  NS_ASSERT_MSG (m_file != 0, "FlowStatsWriter is not open");
+  m_record.clear ();
+  PutUnsigned (id);
+  PutUnsigned (tuple.sourceAddress.Get ());
+  PutUnsigned (tuple.destinationAddress.Get ());
+  PutUnsigned (tuple.protocol);
+  PutUnsigned (tuple.sourcePort);
+  PutUnsigned (tuple.destinationPort);
+  PutSigned (stats.timeFirstTxPacket.GetNanoSeconds ());
+  PutSigned (stats.timeFirstRxPacket.GetNanoSeconds ());
+  PutSigned (stats.timeLastTxPacket.GetNanoSeconds ());
+  PutSigned (stats.timeLastRxPacket.GetNanoSeconds ());
+  PutSigned (stats.delaySum.GetNanoSeconds ());
+  PutSigned (stats.jitterSum.GetNanoSeconds ());
+  PutSigned (stats.lastDelay.GetNanoSeconds ());
+  PutUnsigned (stats.txBytes);
+  PutUnsigned (stats.rxBytes);
+  PutUnsigned (stats.txPackets);
+  PutUnsigned (stats.rxPackets);
+  PutUnsigned (stats.lostPackets);
+  PutUnsigned (stats.timesForwarded);
+  if (m_flags & HISTOGRAMS)
+    {
+      PutUnsigned (stats.packetsDropped.size ());
+      for (uint32_t i = 0; i < stats.packetsDropped.size (); ++i)
+        {
+          PutUnsigned (stats.packetsDropped[i]);
+        }
+      PutUnsigned (stats.bytesDropped.size ());
+      for (uint32_t i = 0; i < stats.bytesDropped.size (); ++i)
+        {
+          PutUnsigned (stats.bytesDropped[i]);
+        }
+      PutHistogram (stats.delayHistogram);
+      PutHistogram (stats.jitterHistogram);
+      PutHistogram (stats.packetSizeHistogram);
+      PutHistogram (stats.flowInterruptionsHistogram);
+    }
+
+  // The type and length go in front of the payload built above.
+  uint8_t type = FLOW_STATS_FLOW;
+  size_t payload = m_record.size ();
+  PutUnsigned (payload);
+  std::fputc (type, m_file);
+  std::fwrite (m_record.data () + payload, 1, m_record.size () - payload, m_file);
+  std::fwrite (m_record.data (), 1, payload, m_file);
+}
+
+inline
+FlowStatsReader::FlowStatsReader (std::string filename)
+  : m_file (0),
+    m_name (filename),
+    m_flags (0),
+    m_pos (0)
+{
+  m_file = std::fopen (filename.c_str (), "rb");
+  if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open flow statistics file " << filename);
+    }
+  char magic[8];
+  uint32_t version;
+  if (std::fread (magic, sizeof (magic), 1, m_file) != 1
+      || std::strncmp (magic, "NS3FLOW", sizeof (magic)) != 0
+      || std::fread (&version, sizeof (version), 1, m_file) != 1
+      || std::fread (&m_flags, sizeof (m_flags), 1, m_file) != 1)
+    {
+      std::fclose (m_file);
+      NS_FATAL_ERROR ("File " << filename << " is not a flow statistics file");
+    }
+  if (version != FLOW_STATS_FILE_VERSION)
+    {
+      std::fclose (m_file);
+      NS_FATAL_ERROR ("Flow statistics file " << filename << " has unknown version " << version);
+    }
+}
+
+inline
+FlowStatsReader::~FlowStatsReader ()
+{
+  std::fclose (m_file);
+}
+
+inline bool
+FlowStatsReader::ReadLength (uint64_t &v)
+{
+  if (m_flags & FlowStatsWriter::COMPACT)
+    {
+      v = 0;
+      for (int shift = 0; shift < 64; shift += 7)
+        {
+          int c = std::fgetc (m_file);
+          if (c == EOF)
+            {
+              return false;
+            }
+          v |= uint64_t (c & 0x7f) << shift;
+          if ((c & 0x80) == 0)
+            {
+              return true;
+            }
+        }
+      return false;
+    }
+  uint8_t bytes[8];
+  if (std::fread (bytes, 1, 8, m_file) != 8)
+    {
+      return false;
+    }
+  v = 0;
+  for (int i = 0; i < 8; ++i)
+    {
+      v |= uint64_t (bytes[i]) << (8 * i);
+    }
+  return true;
+}
+
+inline uint64_t
+FlowStatsReader::GetUnsigned (void)
+{
+  uint64_t v = 0;
+  if (m_flags & FlowStatsWriter::COMPACT)
+    {
+      for (int shift = 0; m_pos < m_record.size () && shift < 64; shift += 7)
+        {
+          uint8_t c = m_record[m_pos++];
+          v |= uint64_t (c & 0x7f) << shift;
+          if ((c & 0x80) == 0)
+            {
+              return v;
+            }
+        }
+    }
+  else if (m_pos + 8 <= m_record.size ())
+    {
+      for (int i = 0; i < 8; ++i)
+        {
+          v |= uint64_t (m_record[m_pos++]) << (8 * i);
+        }
+      return v;
+    }
+  NS_FATAL_ERROR ("Flow statistics file " << m_name << " has a malformed record");
+  return 0;
+}
+
+inline int64_t
+FlowStatsReader::GetSigned (void)
+{
+  uint64_t v = GetUnsigned ();
+  return int64_t (v >> 1) ^ -int64_t (v & 1);
+}
+
+inline double
+FlowStatsReader::GetDouble (void)
+{
+  if (m_pos + 8 > m_record.size ())
+    {
+      NS_FATAL_ERROR ("Flow statistics file " << m_name << " has a malformed record");
+    }
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i)
+    {
+      bits |= uint64_t (m_record[m_pos++]) << (8 * i);
+    }
+  double v;
+  std::memcpy (&v, &bits, sizeof (v));
+  return v;
+}
+
+inline void
+FlowStatsReader::GetHistogram (FlowStatsHistogram &histogram)
+{
+  histogram.binWidth = GetDouble ();
+  uint32_t bins = GetUnsigned ();
+  histogram.counts.assign (bins, 0);
+  if (m_flags & FlowStatsWriter::COMPACT)
+    {
+      uint32_t nonEmpty = GetUnsigned ();
+      uint32_t bin = 0;
+      for (uint32_t i = 0; i < nonEmpty; ++i)
+        {
+          bin += GetUnsigned ();
+          uint32_t count = GetUnsigned ();
+          if (bin < bins)
+            {
+              histogram.counts[bin] = count;
+            }
+        }
+    }
+  else
+    {
+      for (uint32_t i = 0; i < bins; ++i)
+        {
+          histogram.counts[i] = GetUnsigned ();
+        }
+    }
+}
+
+inline bool
+FlowStatsReader::Next (FlowStatsRecord &record)
+{
+  int type;
+  while ((type = std::fgetc (m_file)) != EOF)
+    {
+      uint64_t length;
+      if (!ReadLength (length))
+        {
+          NS_FATAL_ERROR ("Flow statistics file " << m_name << " is truncated");
+        }
+      if (type != FLOW_STATS_FLOW)
+        {
+          std::fseek (m_file, length, SEEK_CUR);
+          continue;
+        }
+      m_record.resize (length);
+      if (std::fread (m_record.data (), 1, length, m_file) != length)
+        {
+          NS_FATAL_ERROR ("Flow statistics file " << m_name << " is truncated");
+        }
+      m_pos = 0;
+
+      record.flowId = GetUnsigned ();
+      record.sourceAddress = GetUnsigned ();
+      record.destinationAddress = GetUnsigned ();
+      record.protocol = GetUnsigned ();
+      record.sourcePort = GetUnsigned ();
+      record.destinationPort = GetUnsigned ();
+      record.timeFirstTxPacket = GetSigned ();
+      record.timeFirstRxPacket = GetSigned ();
+      record.timeLastTxPacket = GetSigned ();
+      record.timeLastRxPacket = GetSigned ();
+      record.delaySum = GetSigned ();
+      record.jitterSum = GetSigned ();
+      record.lastDelay = GetSigned ();
+      record.txBytes = GetUnsigned ();
+      record.rxBytes = GetUnsigned ();
+      record.txPackets = GetUnsigned ();
+      record.rxPackets = GetUnsigned ();
+      record.lostPackets = GetUnsigned ();
+      record.timesForwarded = GetUnsigned ();
+      record.packetsDropped.clear ();
+      record.bytesDropped.clear ();
+      FlowStatsHistogram empty = { 0, std::vector<uint32_t> () };
+      record.delayHistogram = empty;
+      record.jitterHistogram = empty;
+      record.packetSizeHistogram = empty;
+      record.flowInterruptionsHistogram = empty;
+      if (m_flags & FlowStatsWriter::HISTOGRAMS)
+        {
+          record.packetsDropped.resize (GetUnsigned ());
+          for (uint32_t i = 0; i < record.packetsDropped.size (); ++i)
+            {
+              record.packetsDropped[i] = GetUnsigned ();
+            }
+          record.bytesDropped.resize (GetUnsigned ());
+          for (uint32_t i = 0; i < record.bytesDropped.size (); ++i)
+            {
+              record.bytesDropped[i] = GetUnsigned ();
+            }
+          GetHistogram (record.delayHistogram);
+          GetHistogram (record.jitterHistogram);
+          GetHistogram (record.packetSizeHistogram);
+          GetHistogram (record.flowInterruptionsHistogram);
+        }
+      return true;
+    }
+  return false;
+}
+
+inline std::vector<FlowStatsRecord>
+FlowStatsReader::Load (std::string filename)
+{
+  std::vector<FlowStatsRecord> flows;
+  FlowStatsReader reader (filename);
+  FlowStatsRecord record;
+  while (reader.Next (record))
+    {
+      flows.push_back (record);
+    }
+  return flows;
+}
+
+inline uint32_t
+FlowStatsReader::Print (std::string filename, std::ostream &os)
+{
+  FlowStatsReader reader (filename);
+  FlowStatsRecord f;
+  uint32_t n = 0;
+  os << "# flow source destination protocol txPackets rxPackets lostPackets txBytes rxBytes delaySum jitterSum\n";
+  while (reader.Next (f))
+    {
+      os << f.flowId << ' '
+         << Ipv4Address (f.sourceAddress) << ':' << f.sourcePort << ' '
+         << Ipv4Address (f.destinationAddress) << ':' << f.destinationPort << ' '
+         << unsigned (f.protocol) << ' ' << f.txPackets << ' ' << f.rxPackets << ' '
+         << f.lostPackets << ' ' << f.txBytes << ' ' << f.rxBytes << ' '
+         << f.delaySum / 1e9 << ' ' << f.jitterSum / 1e9 << '\n';
+      ++n;
+    }
+  return n;
+}
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_FILE_H */
@@ -0,0 +1,526 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_STATS_VIEW_H
+#define FLOW_STATS_VIEW_H
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "flow-table-monitor.h"
+
+// ===========================================================================
+//
+// Read access to the live statistics of a FlowMonitor without copying them.
+// The summary loops of the scripts used to do
+//
+//   FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
+//
+// which copies the whole map, and then called classifier->FindFlow, a
+// linear search of the classifier, for every flow.  A FlowStatsView walks
+// the monitor's own map by const reference and remembers the five-tuple of
+// each flow after its first lookup:
+//
+//   Ptr<FlowStatsView> view = Create<FlowStatsView> (monitor, classifier);
+//   view->ForEach ([] (FlowId id, const Ipv4FlowClassifier::FiveTuple &t,
+//                      const FlowMonitor::FlowStats &s) { ... });
+//
+// The view can be used at any time during the run.  FlowStatsSnapshot uses
+// it to write, every interval, what changed in each flow since the previous
+// interval to a compact binary file:
+//
+//   Ptr<FlowStatsSnapshot> snapshots = CreateObject<FlowStatsSnapshot> ();
+//   snapshots->Start (view, "flows.snap", Seconds (1), Seconds (1));
+//
+// A FlowTableMonitor already walks its flows in place, so it is passed to
+// Start directly; the file is the same.
+//
+// The file is a FlowSnapshotHeader followed by one block per interval: a
+// FlowSnapshotBlock, the FlowSnapshotFlow description of every flow first
+// seen in that interval, and a FlowSnapshotDelta for every flow whose
+// counters changed.  FlowStatsSnapshot::Convert (see trace-convert.cc)
+// prints it as text.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Walks the flow statistics of a FlowMonitor in place.
+ */
+class FlowStatsView : public SimpleRefCount<FlowStatsView>
+{
+public:
+  /**
+   * \param monitor the monitor
+   * \param classifier the classifier of the monitor
+   */
+  FlowStatsView (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier);
+
+  /**
+   * Call \p visit (id, tuple, stats) for every flow, in FlowId order.
+   * \param visit the visitor
+   */
+  template <typename Visitor>
+  void ForEach (Visitor visit);
+
+  /**
+   * \return the live statistics of all flows
+   */
+  const FlowMonitor::FlowStatsContainer &GetStats (void) const;
+  /**
+   * \param id a flow
+   * \return the five-tuple of the flow, looked up once
+   */
+  const Ipv4FlowClassifier::FiveTuple &GetFiveTuple (FlowId id);
+  /**
+   * \return the monitor
+   */
+  Ptr<FlowMonitor> GetMonitor (void) const;
+
+private:
+  Ptr<FlowMonitor>                           m_monitor;
+  Ptr<Ipv4FlowClassifier>                    m_classifier;
+  std::vector<Ipv4FlowClassifier::FiveTuple> m_tuples;  //!< indexed by FlowId
+  std::vector<bool>                          m_known;   //!< indexed by FlowId
+};
+
+inline
+FlowStatsView::FlowStatsView (Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+  : m_monitor (monitor),
+    m_classifier (classifier)
+{
+}
+
+template <typename Visitor>
+void
+FlowStatsView::ForEach (Visitor visit)
+{
+  const FlowMonitor::FlowStatsContainer &stats = m_monitor->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainerCI it = stats.begin (); it != stats.end (); ++it)
+    {
+      visit (it->first, GetFiveTuple (it->first), it->second);
+    }
+}
+
+inline const FlowMonitor::FlowStatsContainer &
+FlowStatsView::GetStats (void) const
+{
+  return m_monitor->GetFlowStats ();
+}
+
+inline const Ipv4FlowClassifier::FiveTuple &
+FlowStatsView::GetFiveTuple (FlowId id)
+{
+  // FlowIds are handed out densely from 1, so a vector is enough.
+  if (id >= m_known.size ())
+    {
+      m_tuples.resize (id + 1);
+      m_known.resize (id + 1, false);
+    }
+  if (!m_known[id])
+    {
+      m_tuples[id] = m_classifier->FindFlow (id);
+      m_known[id] = true;
+    }
+  return m_tuples[id];
+}
+
+inline Ptr<FlowMonitor>
+FlowStatsView::GetMonitor (void) const
+{
+  return m_monitor;
+}
+
+/**
+ * \brief The file header of a flow snapshot file.
+ */
+struct FlowSnapshotHeader
+{
+  char magic[8];    //!< "NS3FSNP" and a terminating zero
+  int64_t interval; //!< snapshot interval in nanoseconds
+};
+
+/**
+ * \brief The start of one interval.
+ */
+struct FlowSnapshotBlock
+{
+  int64_t time;   //!< simulation time of the snapshot in nanoseconds
+  uint32_t flows; //!< number of FlowSnapshotFlow that follow
+  uint32_t deltas; //!< number of FlowSnapshotDelta after those
+};
+
+/**
+ * \brief The five-tuple of a flow, written once.
+ */
+struct FlowSnapshotFlow
+{
+  uint32_t flowId;          //!< the flow
+  uint32_t source;          //!< source address
+  uint32_t destination;     //!< destination address
+  uint16_t sourcePort;      //!< source port
+  uint16_t destinationPort; //!< destination port
+  uint8_t protocol;         //!< IP protocol number
+  uint8_t reserved[3];      //!< zero
+};
+
+/**
+ * \brief The change of the counters of one flow over one interval.
+ */
+struct FlowSnapshotDelta
+{
+  uint32_t flowId;      //!< the flow
+  uint32_t lostPackets; //!< packets declared lost
+  uint64_t txBytes;     //!< bytes sent
+  uint64_t rxBytes;     //!< bytes received
+  uint32_t txPackets;   //!< packets sent
+  uint32_t rxPackets;   //!< packets received
+  int64_t delaySum;     //!< sum of the delays of received packets in nanoseconds
+};
+
+/**
+ * \brief Writes the per-interval changes of all flow statistics.
+ */
+class FlowStatsSnapshot : public Object
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  FlowStatsSnapshot ();
+  virtual ~FlowStatsSnapshot ();
+
+  /**
+   * Start writing snapshots.
+   * \param view the flows to snapshot
+   * \param filename the output file
+   * \param start time of the first snapshot
+   * \param interval time between snapshots
+   */
+  void Start (Ptr<FlowStatsView> view, std::string filename, Time start, Time interval);
+  /**
+   * Start writing snapshots of a FlowTableMonitor.
+   * \param monitor the flows to snapshot
+   * \param filename the output file
+   * \param start time of the first snapshot
+   * \param interval time between snapshots
+   */
+  void Start (Ptr<FlowTableMonitor> monitor, std::string filename, Time start, Time interval);
+  /**
+   * Write a last snapshot and close the file.
+   */
+  void Stop (void);
+
+  /**
+   * \return the number of snapshots written
+   */
+  uint32_t GetNSnapshots (void) const;
+
+  /**
+   * Print a snapshot file as text, one line per changed flow and interval:
+   * time, flow, source, destination and the changed counters.
+   * \param filename the snapshot file
+   * \param os the output stream
+   * \return the number of deltas printed
+   */
+  static uint64_t Convert (std::string filename, std::ostream &os);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void Open (std::string filename, Time start, Time interval);
+  void Snapshot (void);
+  template <typename Tuple, typename Stats>
+  void Record (FlowId id, const Tuple &t, const Stats &s);
+
+  /// The counters of a flow at the previous snapshot.
+  struct Totals
+  {
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t lostPackets;
+    int64_t delaySum;
+    bool seen;
+  };
+
+  Ptr<FlowStatsView>                m_view;
+  Ptr<FlowTableMonitor>             m_table;
+  std::FILE                        *m_file;
+  std::vector<Totals>               m_last;   //!< indexed by FlowId
+  std::vector<FlowSnapshotFlow>     m_flows;
+  std::vector<FlowSnapshotDelta>    m_deltas;
+  Time                              m_interval;
+  bool                              m_checkLost;
+  uint32_t                          m_snapshots;
+  EventId                           m_event;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowStatsSnapshot);
+
+inline TypeId
+FlowStatsSnapshot::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FlowStatsSnapshot")
+    .SetParent<Object> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<FlowStatsSnapshot> ()
+    .AddAttribute ("CheckLost",
+                   "Run FlowMonitor::CheckForLostPackets before each snapshot.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&FlowStatsSnapshot::m_checkLost),
+                   MakeBooleanChecker ())
+    ;
+  return tid;
+}
+
+inline
+FlowStatsSnapshot::FlowStatsSnapshot ()
+  : m_file (0),
+    m_checkLost (true),
+    m_snapshots (0)
+{
+}
+
+inline
+FlowStatsSnapshot::~FlowStatsSnapshot ()
+{
+}
+
+inline void
+FlowStatsSnapshot::DoDispose (void)
+{
+  Simulator::Cancel (m_event);
+  if (m_file != 0)
+    {
+      std::fclose (m_file);
+      m_file = 0;
+    }
+  m_view = 0;
+  m_table = 0;
+  Object::DoDispose ();
+}
+
+inline void
+FlowStatsSnapshot::Start (Ptr<FlowStatsView> view, std::string filename, Time start, Time interval)
+{
+  Open (filename, start, interval);
+  m_view = view;
+}
+
+inline void
+FlowStatsSnapshot::Start (Ptr<FlowTableMonitor> monitor, std::string filename, Time start, Time interval)
+{
+  Open (filename, start, interval);
+  m_table = monitor;
+}
+
+inline void
+FlowStatsSnapshot::Open (std::string filename, Time start, Time interval)
+{
+  NS_ASSERT (interval.IsStrictlyPositive ());
+  Stop ();
+  m_file = std::fopen (filename.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open snapshot file " << filename);
+    }
+  FlowSnapshotHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::strncpy (header.magic, "NS3FSNP", sizeof (header.magic));
+  header.interval = interval.GetNanoSeconds ();
+  std::fwrite (&header, sizeof (header), 1, m_file);
+
+  m_view = 0;
+  m_table = 0;
+  m_interval = interval;
+  m_last.clear ();
+  m_snapshots = 0;
+  m_event = Simulator::Schedule (start - Simulator::Now (), &FlowStatsSnapshot::Snapshot, this);
+}
+
+inline void
+FlowStatsSnapshot::Stop (void)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  Simulator::Cancel (m_event);
+  Snapshot ();
+  Simulator::Cancel (m_event);
+  std::fclose (m_file);
+  m_file = 0;
+}
+
+inline uint32_t
+FlowStatsSnapshot::GetNSnapshots (void) const
+{
+  return m_snapshots;
+}
+
+inline void
+FlowStatsSnapshot::Snapshot (void)
+{
+  m_flows.clear ();
+  m_deltas.clear ();
+  if (m_table != 0)
+    {
+      // Drops are counted as they happen; there is nothing to check.
+      m_table->ForEach ([this] (FlowId id, const FlowTableMonitor::FiveTuple &t,
+                                const FlowTableMonitor::FlowStats &s) { Record (id, t, s); });
+    }
+  else
+    {
+      if (m_checkLost)
+        {
+          m_view->GetMonitor ()->CheckForLostPackets ();
+        }
+      m_view->ForEach ([this] (FlowId id, const Ipv4FlowClassifier::FiveTuple &t,
+                               const FlowMonitor::FlowStats &s) { Record (id, t, s); });
+    }
+
+  FlowSnapshotBlock block;
+  block.time = Simulator::Now ().GetNanoSeconds ();
+  block.flows = m_flows.size ();
+  block.deltas = m_deltas.size ();
+  std::fwrite (&block, sizeof (block), 1, m_file);
+  std::fwrite (m_flows.data (), sizeof (FlowSnapshotFlow), m_flows.size (), m_file);
+  std::fwrite (m_deltas.data (), sizeof (FlowSnapshotDelta), m_deltas.size (), m_file);
+  ++m_snapshots;
+
+  m_event = Simulator::Schedule (m_interval, &FlowStatsSnapshot::Snapshot, this);
+}
+
+template <typename Tuple, typename Stats>
+void
+FlowStatsSnapshot::Record (FlowId id, const Tuple &t, const Stats &s)
+{
+  if (id >= m_last.size ())
+    {
+      Totals zero = { 0, 0, 0, 0, 0, 0, false };
+      m_last.resize (id + 1, zero);
+    }
+  Totals &last = m_last[id];
+  if (!last.seen)
+    {
+      FlowSnapshotFlow flow;
+      std::memset (&flow, 0, sizeof (flow));
+      flow.flowId = id;
+      flow.source = t.sourceAddress.Get ();
+      flow.destination = t.destinationAddress.Get ();
+      flow.sourcePort = t.sourcePort;
+      flow.destinationPort = t.destinationPort;
+      flow.protocol = t.protocol;
+      m_flows.push_back (flow);
+      last.seen = true;
+    }
+
+  if (s.txPackets == last.txPackets && s.rxPackets == last.rxPackets
+      && s.lostPackets == last.lostPackets)
+    {
+      return;
+    }
+  int64_t delaySum = s.delaySum.GetNanoSeconds ();
+  FlowSnapshotDelta delta;
+  delta.flowId = id;
+  delta.lostPackets = s.lostPackets - last.lostPackets;
+  delta.txBytes = s.txBytes - last.txBytes;
+  delta.rxBytes = s.rxBytes - last.rxBytes;
+  delta.txPackets = s.txPackets - last.txPackets;
+  delta.rxPackets = s.rxPackets - last.rxPackets;
+  delta.delaySum = delaySum - last.delaySum;
+  m_deltas.push_back (delta);
+
+  last.txBytes = s.txBytes;
+  last.rxBytes = s.rxBytes;
+  last.txPackets = s.txPackets;
+  last.rxPackets = s.rxPackets;
+  last.lostPackets = s.lostPackets;
+  last.delaySum = delaySum;
+}
+
+inline uint64_t
+FlowStatsSnapshot::Convert (std::string filename, std::ostream &os)
+{
+  std::FILE *in = std::fopen (filename.c_str (), "rb");
+  if (in == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open snapshot file " << filename);
+    }
+  FlowSnapshotHeader header;
+  if (std::fread (&header, sizeof (header), 1, in) != 1
+      || std::strncmp (header.magic, "NS3FSNP", sizeof (header.magic)) != 0)
+    {
+      std::fclose (in);
+      NS_FATAL_ERROR ("Snapshot file " << filename << " is not a valid snapshot file");
+    }
+
+  os << "# time flow source destination txBytes rxBytes txPackets rxPackets lostPackets delaySum\n";
+  std::vector<FlowSnapshotFlow> flows; // indexed by FlowId
+  std::vector<FlowSnapshotFlow> block;
+  std::vector<FlowSnapshotDelta> deltas;
+  uint64_t count = 0;
+  FlowSnapshotBlock b;
+  while (std::fread (&b, sizeof (b), 1, in) == 1)
+    {
+      block.resize (b.flows);
+      deltas.resize (b.deltas);
+      if (std::fread (block.data (), sizeof (FlowSnapshotFlow), block.size (), in) != block.size ()
+          || std::fread (deltas.data (), sizeof (FlowSnapshotDelta), deltas.size (), in) != deltas.size ())
+        {
+          std::fclose (in);
+          NS_FATAL_ERROR ("Snapshot file " << filename << " is truncated");
+        }
+      for (uint32_t i = 0; i < block.size (); ++i)
+        {
+          if (block[i].flowId >= flows.size ())
+            {
+              flows.resize (block[i].flowId + 1);
+            }
+          flows[block[i].flowId] = block[i];
+        }
+      for (uint32_t i = 0; i < deltas.size (); ++i)
+        {
+          const FlowSnapshotDelta &d = deltas[i];
+          NS_ASSERT (d.flowId < flows.size ());
+          const FlowSnapshotFlow &f = flows[d.flowId];
+          os << b.time / 1e9 << ' ' << d.flowId << ' '
+             << Ipv4Address (f.source) << ':' << f.sourcePort << ' '
+             << Ipv4Address (f.destination) << ':' << f.destinationPort << ' '
+             << d.txBytes << ' ' << d.rxBytes << ' ' << d.txPackets << ' ' << d.rxPackets << ' '
+             << d.lostPackets << ' ' << d.delaySum / 1e9 << '\n';
+        }
+      count += deltas.size ();
+    }
+  std::fclose (in);
+  return count;
+}
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_VIEW_H */
@@ -0,0 +1,795 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_TABLE_MONITOR_H
+#define FLOW_TABLE_MONITOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-classifier.h"
+#include "latency-histogram.h"
+
+// ===========================================================================
+//
+// A light end-to-end flow monitor for runs with many flows.  FlowMonitor
+// classifies every packet at every probe through the ordered maps of
+// Ipv4FlowClassifier and keeps its statistics in a std::map; with
+// FlowMonitorHelper::InstallAll that is paid at every hop.
+//
+// FlowTableMonitor classifies a packet once, when its source sends it: the
+// five-tuple is looked up in an open-addressing hash table (linear probing,
+// power-of-two capacity) that maps it to a dense FlowId, and the packet is
+// tagged with that FlowId and its send time.  Forwarding nodes and the
+// receiver only read the tag and update the flow's entry in a vector of
+// statistics indexed by FlowId.  Nothing is ordered; per packet the only
+// allocation is the packet tag, which the receiver removes again.
+//
+//   Ptr<FlowTableMonitor> flows = CreateObject<FlowTableMonitor> ();
+//   flows->InstallAll ();
+//   Simulator::Run ();
+//   for (FlowId id = 1; id <= flows->GetNFlows (); ++id)
+//     {
+//       const FlowTableMonitor::FlowStats &s = flows->GetStats (id);
+//       ...
+//     }
+//
+// The FlowStats fields are named as in FlowMonitor::FlowStats.  Lost packets
+// are those dropped by an Ipv4L3Protocol of a monitored node; packets that
+// never arrived for other reasons show as txPackets - rxPackets.  Install
+// the monitor after the Internet stack and before the first packet is sent.
+//
+// For large runs the monitor can sample, set through its attributes (or
+// --ns3::FlowTableMonitor::SamplingMode=Packet on the command line):
+//
+//   Flow    only flows whose five-tuple hashes to 0 modulo SamplingRate are
+//           monitored, each of them exactly
+//   Packet  only packets whose uid hashes to 0 modulo SamplingRate are
+//           monitored, in every flow
+//
+// The decision is made once, at the source, and travels with the tag, so
+// every hop sees the same packets and loss and delay stay unbiased.
+// Unsampled packets are neither classified nor tagged, so the per-packet
+// cost drops with the rate.  The Estimate functions scale the sampled
+// counters back up and give the half-width of a 95% confidence interval.
+// In Packet mode jitterSum is taken between consecutive sampled packets.
+//
+// With LatencyHistograms set, the delay of every received packet is also
+// recorded in a LatencyHistogram of its flow, for percentiles:
+//
+//   flows->GetLatencyHistogram (id).GetPercentile (99)
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief The FlowId and send time carried by a monitored packet.
+ */
+class FlowTableTag : public Tag
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  uint32_t flowId;  //!< the flow of the packet
+  int64_t txTime;   //!< send time in nanoseconds
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowTableTag);
+
+inline TypeId
+FlowTableTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FlowTableTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<FlowTableTag> ()
+    ;
+  return tid;
+}
+
+inline TypeId
+FlowTableTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+inline uint32_t
+FlowTableTag::GetSerializedSize (void) const
+{
+  return 12;
+}
+
+inline void
+FlowTableTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (flowId);
+  i.WriteU64 (txTime);
+}
+
+inline void
+FlowTableTag::Deserialize (TagBuffer i)
+{
+  flowId = i.ReadU32 ();
+  txTime = i.ReadU64 ();
+}
+
+inline void
+FlowTableTag::Print (std::ostream &os) const
+{
+  os << "flowId=" << flowId << " txTime=" << txTime;
+}
+
+/**
+ * \brief An end-to-end flow monitor backed by a flat hash table.
+ */
+class FlowTableMonitor : public Object
+{
+public:
+  /// The five-tuple of a flow.
+  struct FiveTuple
+  {
+    Ipv4Address sourceAddress;      //!< source address
+    Ipv4Address destinationAddress; //!< destination address
+    uint8_t protocol;               //!< IP protocol number
+    uint16_t sourcePort;            //!< source port
+    uint16_t destinationPort;       //!< destination port
+  };
+
+  /// The statistics of a flow.
+  struct FlowStats
+  {
+    Time timeFirstTxPacket;  //!< when the first packet was sent
+    Time timeFirstRxPacket;  //!< when the first packet was received
+    Time timeLastTxPacket;   //!< when the last packet was sent
+    Time timeLastRxPacket;   //!< when the last packet was received
+    Time delaySum;           //!< sum of the delays of received packets
+    Time jitterSum;          //!< sum of the delay differences of consecutive packets
+    Time lastDelay;          //!< delay of the last received packet
+    uint64_t txBytes;        //!< bytes sent, with IP header
+    uint64_t rxBytes;        //!< bytes received, with IP header
+    uint32_t txPackets;      //!< packets sent
+    uint32_t rxPackets;      //!< packets received
+    uint32_t lostPackets;    //!< packets dropped by a monitored IP layer
+    uint32_t timesForwarded; //!< forwarding hops of received packets
+    double delaySquareSum;   //!< sum of the squared delays in s^2
+  };
+
+  /// How packets are selected.
+  enum SamplingMode
+  {
+    SAMPLE_NONE,   //!< every packet
+    SAMPLE_FLOW,   //!< every packet of one in SamplingRate flows
+    SAMPLE_PACKET  //!< one in SamplingRate packets of every flow
+  };
+
+  /// A counter of FlowStats.
+  enum Counter
+  {
+    TX_PACKETS,
+    RX_PACKETS,
+    TX_BYTES,
+    RX_BYTES,
+    LOST_PACKETS
+  };
+
+  /// An estimate scaled up from the sampled packets.
+  struct Estimate
+  {
+    double value; //!< the estimate
+    double error; //!< half-width of its 95% confidence interval
+  };
+
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  FlowTableMonitor ();
+  virtual ~FlowTableMonitor ();
+
+  /**
+   * Monitor the IPv4 layer of \p node.
+   * \param node a node with the Internet stack
+   */
+  void Install (Ptr<Node> node);
+  /**
+   * \param nodes nodes with the Internet stack
+   */
+  void Install (NodeContainer nodes);
+  /**
+   * Monitor every node with the Internet stack.
+   */
+  void InstallAll (void);
+
+  /**
+   * \return the number of flows; FlowIds run from 1 to this
+   */
+  uint32_t GetNFlows (void) const;
+  /**
+   * \param id a flow
+   * \return its statistics
+   */
+  const FlowStats &GetStats (FlowId id) const;
+  /**
+   * \param id a flow
+   * \return its five-tuple
+   */
+  const FiveTuple &GetFiveTuple (FlowId id) const;
+  /**
+   * \param tuple a five-tuple
+   * \return the flow of \p tuple, or 0 if no packet of it was sent
+   */
+  FlowId FindFlow (const FiveTuple &tuple) const;
+
+  /**
+   * Call \p visit (id, tuple, stats) for every flow, in FlowId order.
+   * \param visit the visitor
+   */
+  template <typename Visitor>
+  void ForEach (Visitor visit) const;
+
+  /**
+   * \param id a flow
+   * \return the delays of the received packets of the flow; empty unless
+   *         the LatencyHistograms attribute is set
+   */
+  const LatencyHistogram &GetLatencyHistogram (FlowId id) const;
+
+  /**
+   * \return the sampling mode
+   */
+  SamplingMode GetSamplingMode (void) const;
+  /**
+   * \return one in how many flows or packets is sampled
+   */
+  uint32_t GetSamplingRate (void) const;
+
+  /**
+   * \param id a flow
+   * \param counter a counter
+   * \return the estimated value of the counter for the whole flow
+   */
+  Estimate EstimateFlow (FlowId id, Counter counter) const;
+  /**
+   * \param counter a counter
+   * \return the estimated sum of the counter over all flows, sampled or not
+   */
+  Estimate EstimateTotal (Counter counter) const;
+  /**
+   * \param id a flow
+   * \return the estimated fraction of the packets of the flow not received
+   */
+  Estimate EstimateLossRatio (FlowId id) const;
+  /**
+   * \param id a flow
+   * \return the estimated mean delay of the flow in seconds
+   */
+  Estimate EstimateMeanDelay (FlowId id) const;
+
+private:
+  static uint64_t Mix (uint64_t h);
+  static uint64_t Hash (const FiveTuple &tuple);
+  static bool Equal (const FiveTuple &a, const FiveTuple &b);
+  static double GetCounter (const FlowStats &stats, Counter counter);
+  static double GetCountOf (const FlowStats &stats, Counter counter);
+  FlowId Classify (const FiveTuple &tuple, uint64_t hash);
+  void Grow (void);
+
+  void SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+  void UnicastForward (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+  void LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+  void Drop (const Ipv4Header &header, Ptr<const Packet> packet,
+             Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface);
+
+  std::vector<uint32_t>  m_slots;   //!< FlowId per slot, 0 when empty
+  uint32_t               m_mask;    //!< number of slots - 1
+  std::vector<FiveTuple> m_tuples;  //!< indexed by FlowId - 1
+  std::vector<FlowStats> m_stats;   //!< indexed by FlowId - 1
+  std::vector<LatencyHistogram> m_latency; //!< indexed by FlowId - 1, if enabled
+  uint32_t               m_initialSize;
+  bool                   m_latencyEnabled;
+  SamplingMode           m_samplingMode;
+  uint32_t               m_samplingRate;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowTableMonitor);
+
+inline TypeId
+FlowTableMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FlowTableMonitor")
+    .SetParent<Object> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<FlowTableMonitor> ()
+    .AddAttribute ("ExpectedFlows",
+                   "The number of flows to size the table for.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&FlowTableMonitor::m_initialSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LatencyHistograms",
+                   "Keep a latency histogram of every flow.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FlowTableMonitor::m_latencyEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SamplingMode",
+                   "Which packets are monitored.",
+                   EnumValue (SAMPLE_NONE),
+                   MakeEnumAccessor (&FlowTableMonitor::m_samplingMode),
+                   MakeEnumChecker (SAMPLE_NONE, "None",
+                                    SAMPLE_FLOW, "Flow",
+                                    SAMPLE_PACKET, "Packet"))
+    .AddAttribute ("SamplingRate",
+                   "One in how many flows or packets is monitored.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&FlowTableMonitor::m_samplingRate),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+inline
+FlowTableMonitor::FlowTableMonitor ()
+  : m_mask (0),
+    m_initialSize (64),
+    m_latencyEnabled (false),
+    m_samplingMode (SAMPLE_NONE),
+    m_samplingRate (1)
+{
+}
+
+inline
+FlowTableMonitor::~FlowTableMonitor ()
+{
+}
+
+inline void
+FlowTableMonitor::Install (Ptr<Node> node)
+{
+  Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+  NS_ASSERT_MSG (ipv4 != 0, "Install the Internet stack first");
+  ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&FlowTableMonitor::SendOutgoing, this));
+  ipv4->TraceConnectWithoutContext ("UnicastForward", MakeCallback (&FlowTableMonitor::UnicastForward, this));
+  ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&FlowTableMonitor::LocalDeliver, this));
+  ipv4->TraceConnectWithoutContext ("Drop", MakeCallback (&FlowTableMonitor::Drop, this));
+}
+
+inline void
+FlowTableMonitor::Install (NodeContainer nodes)
+{
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      Install (*it);
+    }
+}
+
+inline void
+FlowTableMonitor::InstallAll (void)
+{
+  NodeContainer all = NodeContainer::GetGlobal ();
+  for (NodeContainer::Iterator it = all.Begin (); it != all.End (); ++it)
+    {
+      if ((*it)->GetObject<Ipv4L3Protocol> () != 0)
+        {
+          Install (*it);
+        }
+    }
+}
+
+inline uint32_t
+FlowTableMonitor::GetNFlows (void) const
+{
+  return m_stats.size ();
+}
+
+inline const FlowTableMonitor::FlowStats &
+FlowTableMonitor::GetStats (FlowId id) const
+{
+  NS_ASSERT (id >= 1 && id <= m_stats.size ());
+  return m_stats[id - 1];
+}
+
+inline const FlowTableMonitor::FiveTuple &
+FlowTableMonitor::GetFiveTuple (FlowId id) const
+{
+  NS_ASSERT (id >= 1 && id <= m_tuples.size ());
+  return m_tuples[id - 1];
+}
+
+template <typename Visitor>
+void
+FlowTableMonitor::ForEach (Visitor visit) const
+{
+  for (uint32_t i = 0; i < m_stats.size (); ++i)
+    {
+      visit (FlowId (i + 1), m_tuples[i], m_stats[i]);
+    }
+}
+
+inline const LatencyHistogram &
+FlowTableMonitor::GetLatencyHistogram (FlowId id) const
+{
+  static const LatencyHistogram empty;
+  NS_ASSERT (id >= 1 && id <= m_stats.size ());
+  return id <= m_latency.size () ? m_latency[id - 1] : empty;
+}
+
+inline FlowTableMonitor::SamplingMode
+FlowTableMonitor::GetSamplingMode (void) const
+{
+  return m_samplingMode;
+}
+
+inline uint32_t
+FlowTableMonitor::GetSamplingRate (void) const
+{
+  return m_samplingMode == SAMPLE_NONE ? 1 : m_samplingRate;
+}
+
+inline double
+FlowTableMonitor::GetCounter (const FlowStats &stats, Counter counter)
+{
+  switch (counter)
+    {
+    case TX_PACKETS:
+      return stats.txPackets;
+    case RX_PACKETS:
+      return stats.rxPackets;
+    case TX_BYTES:
+      return stats.txBytes;
+    case RX_BYTES:
+      return stats.rxBytes;
+    case LOST_PACKETS:
+      return stats.lostPackets;
+    }
+  return 0;
+}
+
+inline double
+FlowTableMonitor::GetCountOf (const FlowStats &stats, Counter counter)
+{
+  // The number of sampled packets a counter sums over
+  switch (counter)
+    {
+    case TX_PACKETS:
+    case TX_BYTES:
+      return stats.txPackets;
+    case RX_PACKETS:
+    case RX_BYTES:
+      return stats.rxPackets;
+    case LOST_PACKETS:
+      return stats.lostPackets;
+    }
+  return 0;
+}
+
+inline FlowTableMonitor::Estimate
+FlowTableMonitor::EstimateFlow (FlowId id, Counter counter) const
+{
+  const FlowStats &stats = GetStats (id);
+  double x = GetCounter (stats, counter);
+  Estimate estimate = { x, 0 };
+  if (m_samplingMode != SAMPLE_PACKET || m_samplingRate == 1)
+    {
+      // Not sampled, or a sampled flow, which is seen whole
+      return estimate;
+    }
+  // Each packet is kept with probability p = 1 / N; the Horvitz-Thompson
+  // estimate x / p has variance (1 - p) / p^2 times the sum of the squared
+  // packet values, approximated here by the squared mean packet value.
+  double n = GetCountOf (stats, counter);
+  double rate = m_samplingRate;
+  estimate.value = x * rate;
+  if (n > 0)
+    {
+      estimate.error = 1.96 * std::sqrt ((rate - 1) * rate * x * x / n);
+    }
+  return estimate;
+}
+
+inline FlowTableMonitor::Estimate
+FlowTableMonitor::EstimateTotal (Counter counter) const
+{
+  Estimate total = { 0, 0 };
+  double variance = 0;
+  double rate = m_samplingRate;
+  for (FlowId id = 1; id <= m_stats.size (); ++id)
+    {
+      if (m_samplingMode == SAMPLE_FLOW && m_samplingRate > 1)
+        {
+          // Each flow is kept with probability 1 / N.
+          double x = GetCounter (m_stats[id - 1], counter);
+          total.value += x * rate;
+          variance += (rate - 1) * rate * x * x;
+        }
+      else
+        {
+          Estimate flow = EstimateFlow (id, counter);
+          total.value += flow.value;
+          variance += (flow.error / 1.96) * (flow.error / 1.96);
+        }
+    }
+  total.error = 1.96 * std::sqrt (variance);
+  return total;
+}
+
+inline FlowTableMonitor::Estimate
+FlowTableMonitor::EstimateLossRatio (FlowId id) const
+{
+  const FlowStats &stats = GetStats (id);
+  Estimate estimate = { 0, 0 };
+  if (stats.txPackets == 0)
+    {
+      return estimate;
+    }
+  double tx = stats.txPackets;
+  double ratio = (tx - std::min (tx, double (stats.rxPackets))) / tx;
+  estimate.value = ratio;
+  if (m_samplingMode == SAMPLE_PACKET && m_samplingRate > 1)
+    {
+      estimate.error = 1.96 * std::sqrt (ratio * (1 - ratio) / tx);
+    }
+  return estimate;
+}
+
+inline FlowTableMonitor::Estimate
+FlowTableMonitor::EstimateMeanDelay (FlowId id) const
+{
+  const FlowStats &stats = GetStats (id);
+  Estimate estimate = { 0, 0 };
+  if (stats.rxPackets == 0)
+    {
+      return estimate;
+    }
+  double rx = stats.rxPackets;
+  double mean = stats.delaySum.GetSeconds () / rx;
+  estimate.value = mean;
+  if (m_samplingMode == SAMPLE_PACKET && m_samplingRate > 1)
+    {
+      double variance = std::max (0.0, stats.delaySquareSum / rx - mean * mean);
+      estimate.error = 1.96 * std::sqrt (variance / rx);
+    }
+  return estimate;
+}
+
+inline uint64_t
+FlowTableMonitor::Mix (uint64_t h)
+{
+  // The splitmix64 finalizer: every input bit affects the low bits used
+  // as the slot index.
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+inline uint64_t
+FlowTableMonitor::Hash (const FiveTuple &tuple)
+{
+  uint64_t h = (uint64_t (tuple.sourceAddress.Get ()) << 32) | tuple.destinationAddress.Get ();
+  h ^= (uint64_t (tuple.sourcePort) << 40) ^ (uint64_t (tuple.destinationPort) << 16) ^ tuple.protocol;
+  return Mix (h);
+}
+
+inline bool
+FlowTableMonitor::Equal (const FiveTuple &a, const FiveTuple &b)
+{
+  return a.sourceAddress == b.sourceAddress && a.destinationAddress == b.destinationAddress
+         && a.sourcePort == b.sourcePort && a.destinationPort == b.destinationPort
+         && a.protocol == b.protocol;
+}
+
+inline FlowId
+FlowTableMonitor::FindFlow (const FiveTuple &tuple) const
+{
+  if (m_slots.empty ())
+    {
+      return 0;
+    }
+  for (uint32_t slot = Hash (tuple) & m_mask; m_slots[slot] != 0; slot = (slot + 1) & m_mask)
+    {
+      if (Equal (m_tuples[m_slots[slot] - 1], tuple))
+        {
+          return m_slots[slot];
+        }
+    }
+  return 0;
+}
+
+inline void
+FlowTableMonitor::Grow (void)
+{
+  uint32_t size = m_slots.empty () ? 2 : 2 * m_slots.size ();
+  while (size < 2 * m_initialSize)
+    {
+      size *= 2;
+    }
+  m_slots.assign (size, 0);
+  m_mask = size - 1;
+  for (uint32_t i = 0; i < m_tuples.size (); ++i)
+    {
+      uint32_t slot = Hash (m_tuples[i]) & m_mask;
+      while (m_slots[slot] != 0)
+        {
+          slot = (slot + 1) & m_mask;
+        }
+      m_slots[slot] = i + 1;
+    }
+}
+
+inline FlowId
+FlowTableMonitor::Classify (const FiveTuple &tuple, uint64_t hash)
+{
+  // Keep the load factor at most one half, so probe runs stay short.
+  if (2 * (m_tuples.size () + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+  uint32_t slot = hash & m_mask;
+  for (; m_slots[slot] != 0; slot = (slot + 1) & m_mask)
+    {
+      if (Equal (m_tuples[m_slots[slot] - 1], tuple))
+        {
+          return m_slots[slot];
+        }
+    }
+  FlowStats stats;
+  stats.txBytes = 0;
+  stats.rxBytes = 0;
+  stats.txPackets = 0;
+  stats.rxPackets = 0;
+  stats.lostPackets = 0;
+  stats.timesForwarded = 0;
+  stats.delaySquareSum = 0;
+  m_tuples.push_back (tuple);
+  m_stats.push_back (stats);
+  if (m_latencyEnabled)
+    {
+      m_latency.push_back (LatencyHistogram ());
+    }
+  m_slots[slot] = m_tuples.size ();
+  return m_slots[slot];
+}
+
+inline void
+FlowTableMonitor::SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  // A packet that already carries a tag was classified by the node that
+  // first sent it.
+  FlowTableTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      return;
+    }
+  // The upper hash bits select samples; the lower ones index the table.
+  if (m_samplingMode == SAMPLE_PACKET && (Mix (packet->GetUid ()) >> 32) % m_samplingRate != 0)
+    {
+      return;
+    }
+
+  FiveTuple tuple;
+  tuple.sourceAddress = header.GetSource ();
+  tuple.destinationAddress = header.GetDestination ();
+  tuple.protocol = header.GetProtocol ();
+  tuple.sourcePort = 0;
+  tuple.destinationPort = 0;
+  if ((tuple.protocol == 6 || tuple.protocol == 17) && packet->GetSize () >= 4)
+    {
+      // TCP and UDP both start with the source and destination port.
+      uint8_t ports[4];
+      packet->CopyData (ports, 4);
+      tuple.sourcePort = (ports[0] << 8) | ports[1];
+      tuple.destinationPort = (ports[2] << 8) | ports[3];
+    }
+
+  uint64_t hash = Hash (tuple);
+  if (m_samplingMode == SAMPLE_FLOW && (hash >> 32) % m_samplingRate != 0)
+    {
+      return;
+    }
+
+  Time now = Simulator::Now ();
+  FlowId id = Classify (tuple, hash);
+  FlowStats &stats = m_stats[id - 1];
+  if (stats.txPackets == 0)
+    {
+      stats.timeFirstTxPacket = now;
+    }
+  stats.timeLastTxPacket = now;
+  stats.txPackets++;
+  stats.txBytes += packet->GetSize () + header.GetSerializedSize ();
+
+  tag.flowId = id;
+  tag.txTime = now.GetNanoSeconds ();
+  packet->AddPacketTag (tag);
+}
+
+inline void
+FlowTableMonitor::UnicastForward (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  FlowTableTag tag;
+  if (packet->PeekPacketTag (tag) && tag.flowId >= 1 && tag.flowId <= m_stats.size ())
+    {
+      m_stats[tag.flowId - 1].timesForwarded++;
+    }
+}
+
+inline void
+FlowTableMonitor::LocalDeliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  FlowTableTag tag;
+  if (!ConstCast<Packet> (packet)->RemovePacketTag (tag))
+    {
+      return;
+    }
+  // Removed as Ipv4FlowProbe does, so that a received packet sent on again
+  // is classified as a packet of its new flow.
+  if (tag.flowId == 0 || tag.flowId > m_stats.size ())
+    {
+      return;
+    }
+  Time now = Simulator::Now ();
+  Time delay = now - NanoSeconds (tag.txTime);
+  FlowStats &stats = m_stats[tag.flowId - 1];
+  if (stats.rxPackets == 0)
+    {
+      stats.timeFirstRxPacket = now;
+    }
+  else
+    {
+      stats.jitterSum += (delay > stats.lastDelay) ? delay - stats.lastDelay : stats.lastDelay - delay;
+    }
+  stats.lastDelay = delay;
+  stats.delaySum += delay;
+  stats.delaySquareSum += delay.GetSeconds () * delay.GetSeconds ();
+  if (tag.flowId <= m_latency.size ())
+    {
+      m_latency[tag.flowId - 1].Record (delay);
+    }
+  stats.timeLastRxPacket = now;
+  stats.rxPackets++;
+  stats.rxBytes += packet->GetSize () + header.GetSerializedSize ();
+}
+
+inline void
+FlowTableMonitor::Drop (const Ipv4Header &header, Ptr<const Packet> packet,
+                        Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  FlowTableTag tag;
+  if (packet->PeekPacketTag (tag) && tag.flowId >= 1 && tag.flowId <= m_stats.size ())
+    {
+      m_stats[tag.flowId - 1].lostPackets++;
+    }
+}
+
+} // namespace ns3
+
+#endif /* FLOW_TABLE_MONITOR_H */
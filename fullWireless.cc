@@ -62,6 +62,7 @@
 
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/flow-monitor-module.h"
+#include "flow-stats-file.h"
 
 NS_LOG_COMPONENT_DEFINE ("update");
 
@@ -96,6 +97,7 @@ main (int argc, char *argv[])
   
   uint32_t nWifi = 5;
   int no_of_flow = 5;
+  bool xml = false;
 
 
   /* Command line argument parser setup. */
@@ -110,6 +112,7 @@ main (int argc, char *argv[])
                 "TcpBic, TcpYeah, TcpIllinois, TcpWestwood, TcpWestwoodPlus, TcpLedbat ", tcpVariant);
   cmd.AddValue ("phyRate", "Physical layer bitrate", phyRate);
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("xml", "Also write ./lastFiles/history.flowmonitor as XML", xml);
   cmd.Parse (argc, argv);
 
   tcpVariant = std::string ("ns3::") + tcpVariant;
@@ -287,14 +290,18 @@ main (int argc, char *argv[])
 
   flowMonitor->CheckForLostPackets ();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
+  const std::map<FlowId, FlowMonitor::FlowStats> &stats = flowMonitor->GetFlowStats ();
 
   /* Start Simulation */
   Simulator::Stop (Seconds (simulationTime + 1));
   Simulator::Run ();
 
-   /* Flow Monitor File  */
-  flowMonitor->SerializeToXmlFile("./lastFiles/history.flowmonitor",false,false);
+   /* Flow Monitor File; print it with trace-convert --flowstats=... */
+  FlowStatsWriter::Write (flowMonitor, classifier, "./lastFiles/history.flowbin", FlowStatsWriter::COMPACT);
+  if (xml)
+    {
+      flowMonitor->SerializeToXmlFile("./lastFiles/history.flowmonitor",false,false);
+    }
 
   //See implementation of goodput here: https://www.nsnam.org/doxygen/traffic-control_8cc_source.html
   //delaySum: the sum of all end-to-end delays for all received packets of the flow
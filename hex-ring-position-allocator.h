@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef HEX_RING_POSITION_ALLOCATOR_H
+#define HEX_RING_POSITION_ALLOCATOR_H
+
+#include <cmath>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+// ===========================================================================
+//
+// Positions on a triangular lattice, in hexagonal rings around a centre:
+// the centre first, then ring k = 1, 2, ... with 6k positions each, every
+// position exactly Spacing from its neighbours.  n positions fill a disc
+// of radius about Spacing * sqrt (n / 3), so a BSS of thousands of
+// stations stays compact around its AP, unlike a grid of fixed width whose
+// rows run off to one side.  The position is computed from its index
+// alone, without looking at the positions already handed out.
+//
+// GetSpacing gives the spacing at which a number of positions fits a
+// radius, for a layout whose density follows the number of stations.
+//
+//   double spacing = std::min (5.0, HexRingPositionAllocator::GetSpacing (nWifi + 1, 40.0));
+//   mobility.SetPositionAllocator ("ns3::HexRingPositionAllocator",
+//                                  "X", DoubleValue (0.0),
+//                                  "Y", DoubleValue (0.0),
+//                                  "Spacing", DoubleValue (spacing));
+//   mobility.Install (wifiApNode);     // the centre
+//   mobility.Install (wifiStaNodes);   // the rings
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Allocates positions in hexagonal rings around a centre.
+ */
+class HexRingPositionAllocator : public PositionAllocator
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  HexRingPositionAllocator ();
+
+  /**
+   * \param n the number of positions, the centre included
+   * \param radius the radius they have to fit in
+   * \return the largest spacing at which \p n positions lie within
+   *         \p radius of the centre
+   */
+  static double GetSpacing (uint32_t n, double radius);
+  /**
+   * \param n the number of positions, the centre included
+   * \return the number of rings \p n positions take
+   */
+  static uint32_t GetNRings (uint32_t n);
+
+  // Inherited from PositionAllocator
+  virtual Vector GetNext (void) const;
+  virtual int64_t AssignStreams (int64_t stream);
+
+private:
+  double m_x;
+  double m_y;
+  double m_z;
+  double m_spacing;
+  mutable uint32_t m_current;   //!< the index of the next position
+};
+
+NS_OBJECT_ENSURE_REGISTERED (HexRingPositionAllocator);
+
+inline TypeId
+HexRingPositionAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HexRingPositionAllocator")
+    .SetParent<PositionAllocator> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<HexRingPositionAllocator> ()
+    .AddAttribute ("X",
+                   "The x coordinate of the centre.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&HexRingPositionAllocator::m_x),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Y",
+                   "The y coordinate of the centre.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&HexRingPositionAllocator::m_y),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Z",
+                   "The z coordinate of all positions.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&HexRingPositionAllocator::m_z),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Spacing",
+                   "The distance between neighbouring positions.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&HexRingPositionAllocator::m_spacing),
+                   MakeDoubleChecker<double> (0.0))
+  ;
+  return tid;
+}
+
+inline
+HexRingPositionAllocator::HexRingPositionAllocator ()
+  : m_current (0)
+{
+}
+
+inline uint32_t
+HexRingPositionAllocator::GetNRings (uint32_t n)
+{
+  // Rings 0 to k hold 1 + 3k (k + 1) positions
+  uint32_t k = n > 1 ? uint32_t (std::ceil ((std::sqrt (12.0 * n - 3.0) - 3.0) / 6.0)) : 0;
+  while (k > 0 && 1 + 3 * uint64_t (k - 1) * k >= n)
+    {
+      --k;
+    }
+  while (1 + 3 * uint64_t (k) * (k + 1) < n)
+    {
+      ++k;
+    }
+  return k;
+}
+
+inline double
+HexRingPositionAllocator::GetSpacing (uint32_t n, double radius)
+{
+  uint32_t rings = GetNRings (n);
+  return rings > 0 ? radius / rings : radius;
+}
+
+inline Vector
+HexRingPositionAllocator::GetNext (void) const
+{
+  uint32_t i = m_current++;
+  if (i == 0)
+    {
+      return Vector (m_x, m_y, m_z);
+    }
+  // Ring k starts at the corner k * d0 and walks along d2, d3, ..., d1,
+  // where ds is the unit vector at 60s degrees: corner s + 1 is corner s
+  // plus k * d(s + 2).
+  uint32_t k = GetNRings (i + 1);
+  uint32_t j = i - (1 + 3 * (k - 1) * k);
+  uint32_t side = j / k;
+  uint32_t step = j % k;
+  double corner = side * M_PI / 3;
+  double along = (side + 2) * M_PI / 3;
+  double x = k * std::cos (corner) + step * std::cos (along);
+  double y = k * std::sin (corner) + step * std::sin (along);
+  return Vector (m_x + m_spacing * x, m_y + m_spacing * y, m_z);
+}
+
+inline int64_t
+HexRingPositionAllocator::AssignStreams (int64_t stream)
+{
+  return 0;
+}
+
+} // namespace ns3
+
+#endif /* HEX_RING_POSITION_ALLOCATOR_H */
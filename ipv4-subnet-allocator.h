@@ -0,0 +1,226 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef IPV4_SUBNET_ALLOCATOR_H
+#define IPV4_SUBNET_ALLOCATOR_H
+
+#include <iterator>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+// ===========================================================================
+//
+// Addresses for many point-to-point links in one call.  The allocator
+// carves consecutive subnets of one link mask, /30 by default, out of a
+// larger prefix, and Assign gives every two consecutive devices of a
+// container the next subnet: the first device gets the first host address
+// and the second device the second.  This replaces a SetBase and an Assign
+// of Ipv4AddressHelper per link.
+//
+// Ipv4AddressHelper registers each address with the global
+// Ipv4AddressGenerator, whose collision list gets one more entry for every
+// subnet and is walked from the start on every address, so assigning tens
+// of thousands of links is quadratic.  The allocator registers every
+// address of the subnet instead, network and broadcast address included,
+// with one AddAllocated call each; consecutive subnets then merge into a
+// single entry, so each call stays cheap, at the price of one call per
+// address: 4 per link with the default /30, 256 with a /24.  An
+// Ipv4AddressHelper that later hands out an address in the same range
+// still fails with an address collision.  Generated topologies whose
+// ranges cannot overlap can turn the check off altogether.
+//
+// Assign adds an Ipv4 interface for every device without looking for an
+// existing one, since Ipv4::GetInterfaceForDevice walks all interfaces of
+// the node and would make a router with thousands of links quadratic.  The
+// devices must therefore be new, e.g. just installed by a link helper.
+//
+// A /31 link mask (RFC 3021) uses both addresses of each pair.  It needs
+// an ns-3 whose Ipv4Address::IsSubnetDirectedBroadcast is false for a /31
+// mask; older releases take the upper address of the pair for a broadcast.
+//
+//   NetDeviceContainer links;
+//   for (...)
+//     {
+//       links.Add (p2p.Install (a, b));
+//     }
+//   Ipv4SubnetAllocator allocator ("10.0.0.0", "255.0.0.0");
+//   allocator.SetCheckDuplicates (false);
+//   Ipv4InterfaceContainer interfaces = allocator.Assign (links);
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Assigns a subnet of its own to each of many point-to-point links.
+ */
+class Ipv4SubnetAllocator
+{
+public:
+  /**
+   * \param base the network address of the first subnet
+   * \param prefixMask the mask of the prefix the subnets are carved from;
+   *        the last subnet ends where the prefix of \p base ends
+   * \param linkMask the mask of each subnet
+   */
+  Ipv4SubnetAllocator (Ipv4Address base, Ipv4Mask prefixMask,
+                       Ipv4Mask linkMask = Ipv4Mask ("255.255.255.252"));
+
+  /**
+   * \param check whether to register the subnets with Ipv4AddressGenerator,
+   *        which aborts on an address already in use; true by default
+   */
+  void SetCheckDuplicates (bool check);
+
+  /**
+   * Give devices 2i and 2i + 1 of \p devices the next subnet, add them to
+   * their node's Ipv4 and bring them up, and install the default queue
+   * disc on every device that has none yet, as Ipv4AddressHelper::Assign
+   * does.  The devices must not have an Ipv4 interface yet.
+   * \param devices the links, two devices each
+   * \return the interfaces, in the order of \p devices
+   */
+  Ipv4InterfaceContainer Assign (const NetDeviceContainer &devices);
+  /**
+   * \param begin the first device of the first link
+   * \param end one past the second device of the last link
+   * \return the interfaces, in the order of the devices
+   */
+  Ipv4InterfaceContainer Assign (NetDeviceContainer::Iterator begin, NetDeviceContainer::Iterator end);
+
+  /**
+   * Take the next subnet without assigning it, e.g. for a link that is
+   * addressed by hand.
+   * \return the network address of the subnet
+   */
+  Ipv4Address NewSubnet (void);
+  /**
+   * \return the number of subnets not taken yet
+   */
+  uint32_t GetNSubnetsLeft (void) const;
+  /**
+   * \return the mask of each subnet
+   */
+  Ipv4Mask GetLinkMask (void) const;
+
+private:
+  Ipv4Mask m_linkMask;
+  uint64_t m_subnetSize;
+  uint64_t m_next;       //!< the network address of the next subnet
+  uint64_t m_end;        //!< one past the last address of the prefix
+  bool     m_check;
+};
+
+inline
+Ipv4SubnetAllocator::Ipv4SubnetAllocator (Ipv4Address base, Ipv4Mask prefixMask, Ipv4Mask linkMask)
+  : m_linkMask (linkMask),
+    m_subnetSize (uint64_t (~linkMask.Get ()) + 1),
+    m_next (base.Get ()),
+    m_end (uint64_t (base.CombineMask (prefixMask).Get ()) + uint64_t (~prefixMask.Get ()) + 1),
+    m_check (true)
+{
+  NS_ASSERT_MSG (linkMask.GetPrefixLength () <= 31, "A link needs a subnet of at least two addresses");
+  NS_ASSERT_MSG (prefixMask.GetPrefixLength () <= linkMask.GetPrefixLength (),
+                 "The prefix " << prefixMask << " is smaller than a subnet of " << linkMask);
+  NS_ASSERT_MSG (base.CombineMask (linkMask) == base, base << " is not the start of a subnet of " << linkMask);
+}
+
+inline void
+Ipv4SubnetAllocator::SetCheckDuplicates (bool check)
+{
+  m_check = check;
+}
+
+inline Ipv4Address
+Ipv4SubnetAllocator::NewSubnet (void)
+{
+  NS_ABORT_MSG_IF (m_next >= m_end, "No subnet of " << m_linkMask << " left before " << Ipv4Address (uint32_t (m_end - 1)));
+  uint32_t network = uint32_t (m_next);
+  m_next += m_subnetSize;
+  if (m_check)
+    {
+      for (uint64_t a = network; a < network + m_subnetSize; ++a)
+        {
+          Ipv4AddressGenerator::AddAllocated (Ipv4Address (uint32_t (a)));
+        }
+    }
+  return Ipv4Address (network);
+}
+
+inline uint32_t
+Ipv4SubnetAllocator::GetNSubnetsLeft (void) const
+{
+  return m_next < m_end ? uint32_t ((m_end - m_next) / m_subnetSize) : 0;
+}
+
+inline Ipv4Mask
+Ipv4SubnetAllocator::GetLinkMask (void) const
+{
+  return m_linkMask;
+}
+
+inline Ipv4InterfaceContainer
+Ipv4SubnetAllocator::Assign (const NetDeviceContainer &devices)
+{
+  return Assign (devices.Begin (), devices.End ());
+}
+
+inline Ipv4InterfaceContainer
+Ipv4SubnetAllocator::Assign (NetDeviceContainer::Iterator begin, NetDeviceContainer::Iterator end)
+{
+  uint32_t nDevices = std::distance (begin, end);
+  NS_ASSERT_MSG (nDevices % 2 == 0, "Ipv4SubnetAllocator::Assign needs two devices per link");
+  NS_ABORT_MSG_IF (nDevices / 2 > GetNSubnetsLeft (),
+                   nDevices / 2 << " links but only " << GetNSubnetsLeft () << " subnets of " << m_linkMask << " left");
+
+  // A /31 has no network or broadcast address
+  uint32_t firstHost = m_subnetSize == 2 ? 0 : 1;
+  Ipv4InterfaceContainer interfaces;
+  NetDeviceContainer needQueueDisc;
+  for (NetDeviceContainer::Iterator i = begin; i != end; i += 2)
+    {
+      uint32_t network = NewSubnet ().Get ();
+      for (uint32_t side = 0; side < 2; ++side)
+        {
+          Ptr<NetDevice> device = *(i + side);
+          Ptr<Node> node = device->GetNode ();
+          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+          NS_ASSERT_MSG (ipv4, "Ipv4SubnetAllocator::Assign needs an Internet stack on node " << node->GetId ());
+          uint32_t interface = ipv4->AddInterface (device);
+          ipv4->AddAddress (interface, Ipv4InterfaceAddress (Ipv4Address (network + firstHost + side), m_linkMask));
+          ipv4->SetMetric (interface, 1);
+          ipv4->SetUp (interface);
+          interfaces.Add (ipv4, interface);
+
+          Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer> ();
+          if (tc && !tc->GetRootQueueDiscOnDevice (device) && device->GetObject<NetDeviceQueueInterface> ())
+            {
+              needQueueDisc.Add (device);
+            }
+        }
+    }
+
+  // One helper for all devices instead of one per device
+  TrafficControlHelper tch = TrafficControlHelper::Default ();
+  tch.Install (needQueueDisc);
+  return interfaces;
+}
+
+} // namespace ns3
+
+#endif /* IPV4_SUBNET_ALLOCATOR_H */
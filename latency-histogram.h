@@ -0,0 +1,339 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "ns3/core-module.h"
+
+// ===========================================================================
+//
+// A log-linear latency histogram in the style of HdrHistogram.  The range
+// of nanosecond values is split at every power of two, and each power of
+// two into 2^(SignificantBits - 1) equal bins, so every recorded value is
+// kept to a relative precision of 2^-(SignificantBits - 1) whatever its
+// magnitude.  With the default of 6 bits that is about 3%, which separates
+// p99 from p99.9 where FlowMonitor's fixed-width delay histogram has either
+// a few coarse bins or a huge number of fine ones.
+//
+// Recording is a count-leading-zeros, a shift and an increment.  Bins are
+// only allocated up to the largest value seen: delays up to one second take
+// about 800 counters, 3 KB.  Histograms with the same precision can be
+// merged, e.g. all flows of a run into one, and written to and read back
+// from a stream to merge across runs.
+//
+//   LatencyHistogram h;
+//   h.Record (delay);
+//   ...
+//   std::cout << "p99 = " << h.GetPercentile (99) << std::endl;
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief A log-linear histogram of latencies with bounded relative error.
+ */
+class LatencyHistogram
+{
+public:
+  /**
+   * \param significantBits the bits of precision kept of each value, 2 to 16
+   */
+  explicit LatencyHistogram (uint32_t significantBits = 6);
+
+  /**
+   * \param delay the latency to record; negative values count as zero
+   */
+  void Record (Time delay);
+  /**
+   * \param ns the latency to record in nanoseconds
+   * \param count how many times to record it
+   */
+  void RecordValue (uint64_t ns, uint64_t count = 1);
+  /**
+   * Add all values of \p other.
+   * \param other a histogram with the same precision
+   */
+  void Merge (const LatencyHistogram &other);
+  /**
+   * Forget all values.
+   */
+  void Reset (void);
+
+  /**
+   * \return the number of recorded values
+   */
+  uint64_t GetCount (void) const;
+  /**
+   * \return the smallest recorded value
+   */
+  Time GetMin (void) const;
+  /**
+   * \return the largest recorded value
+   */
+  Time GetMax (void) const;
+  /**
+   * \return the mean of the recorded values
+   */
+  Time GetMean (void) const;
+  /**
+   * \param percentile the percentile, from 0 to 100
+   * \return a value no smaller than \p percentile percent of the recorded
+   *         values, within the precision of the histogram
+   */
+  Time GetPercentile (double percentile) const;
+  /**
+   * \return the bytes used by the bins
+   */
+  uint32_t GetMemoryUsage (void) const;
+
+  /**
+   * Write the histogram in a compact binary form.
+   * \param os the output stream
+   */
+  void Write (std::ostream &os) const;
+  /**
+   * Read a histogram written by Write and merge it into this one.
+   * \param is the input stream
+   * \return false if the stream holds no valid histogram
+   */
+  bool Read (std::istream &is);
+
+private:
+  uint32_t GetIndex (uint64_t ns) const;
+  uint64_t GetLowest (uint32_t index) const;
+  uint64_t GetHighest (uint32_t index) const;
+
+  uint32_t              m_halfMagnitude; //!< log2 of the bins per power of two
+  uint64_t              m_subBucketMask;
+  std::vector<uint32_t> m_counts;
+  uint64_t              m_total;
+  uint64_t              m_min;
+  uint64_t              m_max;
+  double                m_sum;
+};
+
+inline
+LatencyHistogram::LatencyHistogram (uint32_t significantBits)
+  : m_halfMagnitude (significantBits - 1),
+    m_subBucketMask ((uint64_t (1) << significantBits) - 1),
+    m_total (0),
+    m_min (UINT64_MAX),
+    m_max (0),
+    m_sum (0)
+{
+  NS_ASSERT_MSG (significantBits >= 2 && significantBits <= 16, "Precision must be 2 to 16 bits");
+}
+
+inline uint32_t
+LatencyHistogram::GetIndex (uint64_t ns) const
+{
+  // Values below 2^significantBits land in bucket 0 exactly; above that,
+  // bucket b holds [2^(b + significantBits - 1), 2^(b + significantBits))
+  // in bins of width 2^b.
+  uint32_t magnitude = 64 - __builtin_clzll (ns | m_subBucketMask);
+  uint32_t bucket = magnitude - m_halfMagnitude - 1;
+  uint64_t subBucket = ns >> bucket;
+  return ((bucket + 1) << m_halfMagnitude) + uint32_t (subBucket - (uint64_t (1) << m_halfMagnitude));
+}
+
+inline uint64_t
+LatencyHistogram::GetLowest (uint32_t index) const
+{
+  int32_t bucket = int32_t (index >> m_halfMagnitude) - 1;
+  uint64_t subBucket = (index & ((1u << m_halfMagnitude) - 1)) + (uint64_t (1) << m_halfMagnitude);
+  if (bucket < 0)
+    {
+      subBucket -= uint64_t (1) << m_halfMagnitude;
+      bucket = 0;
+    }
+  return subBucket << bucket;
+}
+
+inline uint64_t
+LatencyHistogram::GetHighest (uint32_t index) const
+{
+  int32_t bucket = std::max (int32_t (index >> m_halfMagnitude) - 1, 0);
+  return GetLowest (index) + (uint64_t (1) << bucket) - 1;
+}
+
+inline void
+LatencyHistogram::Record (Time delay)
+{
+  int64_t ns = delay.GetNanoSeconds ();
+  RecordValue (ns > 0 ? ns : 0);
+}
+
+inline void
+LatencyHistogram::RecordValue (uint64_t ns, uint64_t count)
+{
+  uint32_t index = GetIndex (ns);
+  if (index >= m_counts.size ())
+    {
+      m_counts.resize (index + 1, 0);
+    }
+  m_counts[index] += count;
+  m_total += count;
+  m_min = std::min (m_min, ns);
+  m_max = std::max (m_max, ns);
+  m_sum += double (ns) * count;
+}
+
+inline void
+LatencyHistogram::Merge (const LatencyHistogram &other)
+{
+  NS_ASSERT_MSG (m_halfMagnitude == other.m_halfMagnitude, "Cannot merge histograms of different precision");
+  if (other.m_counts.size () > m_counts.size ())
+    {
+      m_counts.resize (other.m_counts.size (), 0);
+    }
+  for (uint32_t i = 0; i < other.m_counts.size (); ++i)
+    {
+      m_counts[i] += other.m_counts[i];
+    }
+  m_total += other.m_total;
+  m_min = std::min (m_min, other.m_min);
+  m_max = std::max (m_max, other.m_max);
+  m_sum += other.m_sum;
+}
+
+inline void
+LatencyHistogram::Reset (void)
+{
+  m_counts.clear ();
+  m_total = 0;
+  m_min = UINT64_MAX;
+  m_max = 0;
+  m_sum = 0;
+}
+
+inline uint64_t
+LatencyHistogram::GetCount (void) const
+{
+  return m_total;
+}
+
+inline Time
+LatencyHistogram::GetMin (void) const
+{
+  return NanoSeconds (m_total > 0 ? m_min : 0);
+}
+
+inline Time
+LatencyHistogram::GetMax (void) const
+{
+  return NanoSeconds (m_max);
+}
+
+inline Time
+LatencyHistogram::GetMean (void) const
+{
+  return NanoSeconds (m_total > 0 ? int64_t (m_sum / m_total) : 0);
+}
+
+inline Time
+LatencyHistogram::GetPercentile (double percentile) const
+{
+  if (m_total == 0)
+    {
+      return NanoSeconds (0);
+    }
+  percentile = std::min (std::max (percentile, 0.0), 100.0);
+  uint64_t rank = std::max (uint64_t (1), uint64_t (percentile / 100.0 * m_total + 0.5));
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < m_counts.size (); ++i)
+    {
+      seen += m_counts[i];
+      if (seen >= rank)
+        {
+          return NanoSeconds (std::min (GetHighest (i), m_max));
+        }
+    }
+  return NanoSeconds (m_max);
+}
+
+inline uint32_t
+LatencyHistogram::GetMemoryUsage (void) const
+{
+  return m_counts.capacity () * sizeof (uint32_t);
+}
+
+inline void
+LatencyHistogram::Write (std::ostream &os) const
+{
+  // "LH", the precision, the number of non-empty bins, min, max and sum,
+  // then (index, count) for each non-empty bin.
+  uint32_t nonEmpty = m_counts.size () - std::count (m_counts.begin (), m_counts.end (), 0u);
+  uint32_t header[2] = { 0x484c0000u | (m_halfMagnitude + 1), nonEmpty };
+  os.write (reinterpret_cast<const char *> (header), sizeof (header));
+  os.write (reinterpret_cast<const char *> (&m_min), sizeof (m_min));
+  os.write (reinterpret_cast<const char *> (&m_max), sizeof (m_max));
+  os.write (reinterpret_cast<const char *> (&m_sum), sizeof (m_sum));
+  for (uint32_t i = 0; i < m_counts.size (); ++i)
+    {
+      if (m_counts[i] != 0)
+        {
+          uint32_t bin[2] = { i, m_counts[i] };
+          os.write (reinterpret_cast<const char *> (bin), sizeof (bin));
+        }
+    }
+}
+
+inline bool
+LatencyHistogram::Read (std::istream &is)
+{
+  uint32_t header[2];
+  uint64_t min;
+  uint64_t max;
+  double sum;
+  if (!is.read (reinterpret_cast<char *> (header), sizeof (header))
+      || (header[0] >> 16) != 0x484c || (header[0] & 0xffff) != m_halfMagnitude + 1
+      || !is.read (reinterpret_cast<char *> (&min), sizeof (min))
+      || !is.read (reinterpret_cast<char *> (&max), sizeof (max))
+      || !is.read (reinterpret_cast<char *> (&sum), sizeof (sum)))
+    {
+      return false;
+    }
+  LatencyHistogram other (m_halfMagnitude + 1);
+  for (uint32_t i = 0; i < header[1]; ++i)
+    {
+      uint32_t bin[2];
+      if (!is.read (reinterpret_cast<char *> (bin), sizeof (bin)))
+        {
+          return false;
+        }
+      if (bin[0] >= other.m_counts.size ())
+        {
+          other.m_counts.resize (bin[0] + 1, 0);
+        }
+      other.m_counts[bin[0]] += bin[1];
+      other.m_total += bin[1];
+    }
+  other.m_min = min;
+  other.m_max = max;
+  other.m_sum = sum;
+  Merge (other);
+  return true;
+}
+
+} // namespace ns3
+
+#endif /* LATENCY_HISTOGRAM_H */
@@ -0,0 +1,444 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTI_FLOW_SENDER_H
+#define MULTI_FLOW_SENDER_H
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+// ===========================================================================
+//
+// One application that drives every constant-rate flow of a node.  Instead
+// of one ConstantRateGenerator (and one pending simulator event) per flow,
+// the flows sit in a hashed timing wheel: deadlines are rounded up to ticks
+// of Granularity, a flow lives in slot (tick mod Slots), and rescheduling a
+// flow is a push onto that slot's list.  A bitmap of occupied slots finds the
+// next due slot, and only that slot has a simulator event.
+//
+// Rounding only delays a send to the end of its tick; the next deadline is
+// computed from the exact one, so long-run rates are unchanged.
+//
+//   Ptr<MultiFlowSender> sender = CreateObject<MultiFlowSender> ();
+//   for (...)
+//     {
+//       Ptr<Socket> socket = Socket::CreateSocket (node, TcpSocketFactory::GetTypeId ());
+//       sender->AddFlow (socket, sinkAddress, 1040, 1000, DataRate ("1Mbps"));
+//     }
+//   node->AddApplication (sender);
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Sends many constant-rate flows from one node off a single timer.
+ */
+class MultiFlowSender : public Application
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  MultiFlowSender ();
+  virtual ~MultiFlowSender ();
+
+  /**
+   * \param socket the socket to send on; it is bound and connected at start
+   * \param address the peer address
+   * \param packetSize size of each packet in bytes
+   * \param nPackets number of packets to send; zero means until stopped
+   * \param dataRate the sending rate; not zero
+   * \param startOffset delay of the first packet after the application start
+   * \return the index of the new flow
+   */
+  uint32_t AddFlow (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets,
+                    DataRate dataRate, Time startOffset = Seconds (0));
+  /**
+   * \param flow the flow index returned by AddFlow
+   * \param rate the new sending rate, used from the next packet on; not zero
+   */
+  void ChangeRate (uint32_t flow, DataRate rate);
+  /**
+   * \return the number of flows
+   */
+  uint32_t GetNFlows (void) const;
+  /**
+   * \param flow the flow index returned by AddFlow
+   * \return the number of packets the flow's socket has accepted
+   */
+  uint32_t GetPacketsSent (uint32_t flow) const;
+  /**
+   * \param flow the flow index returned by AddFlow
+   * \return the number of packets the flow's socket refused
+   */
+  uint32_t GetSendFailures (uint32_t flow) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  /// A flow and its wheel linkage.
+  struct Flow
+  {
+    Ptr<Socket> socket;      //!< socket to send on
+    Address peer;            //!< peer address
+    Ptr<Packet> payload;     //!< pristine payload the packets are copied from
+    uint32_t nPackets;       //!< packets to send, zero for unlimited
+    uint32_t packetsSent;    //!< packets the socket accepted so far
+    uint32_t sendFailures;   //!< packets the socket refused
+    DataRate rate;           //!< sending rate
+    Time startOffset;        //!< delay of the first packet
+    Time deadline;           //!< exact time of the next packet
+    uint64_t tick;           //!< deadline rounded up to a wheel tick
+    uint32_t next;           //!< next flow in the same slot
+  };
+
+  /// End of a slot list.
+  enum { NONE = 0xffffffffU };
+
+  void Insert (uint32_t flow);
+  void Link (uint32_t slot, uint32_t flow);
+  void Arm (void);
+  void Expire (void);
+  bool FindNext (uint64_t &tick) const;
+  uint32_t NextOccupied (uint32_t slot) const;
+  uint64_t ToTick (Time t) const;
+
+  Time                  m_granularity;
+  uint32_t              m_nSlots;
+  std::vector<Flow>     m_flows;
+  std::vector<uint32_t> m_slots;
+  std::vector<uint64_t> m_occupied;
+  uint32_t              m_queued;
+  uint64_t              m_cursor;
+  uint64_t              m_eventTick;
+  EventId               m_event;
+  bool                  m_running;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (MultiFlowSender);
+
+inline TypeId
+MultiFlowSender::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultiFlowSender")
+    .SetParent<Application> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<MultiFlowSender> ()
+    .AddAttribute ("Granularity",
+                   "The width of a timing wheel tick.",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&MultiFlowSender::m_granularity),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("Slots",
+                   "The number of timing wheel slots; a power of two, at least 64.",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&MultiFlowSender::m_nSlots),
+                   MakeUintegerChecker<uint32_t> (64))
+    ;
+  return tid;
+}
+
+inline
+MultiFlowSender::MultiFlowSender ()
+  : m_nSlots (4096),
+    m_queued (0),
+    m_cursor (0),
+    m_eventTick (0),
+    m_running (false)
+{
+}
+
+inline
+MultiFlowSender::~MultiFlowSender ()
+{
+}
+
+inline void
+MultiFlowSender::DoDispose (void)
+{
+  m_flows.clear ();
+  Application::DoDispose ();
+}
+
+inline uint32_t
+MultiFlowSender::AddFlow (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets,
+                          DataRate dataRate, Time startOffset)
+{
+  NS_ASSERT (packetSize > 0);
+  NS_ABORT_MSG_IF (dataRate.GetBitRate () == 0, "MultiFlowSender::AddFlow with a zero rate");
+  Flow flow;
+  flow.socket = socket;
+  flow.peer = address;
+  flow.payload = Create<Packet> (packetSize);
+  flow.nPackets = nPackets;
+  flow.packetsSent = 0;
+  flow.sendFailures = 0;
+  flow.rate = dataRate;
+  flow.startOffset = startOffset;
+  flow.tick = 0;
+  flow.next = NONE;
+  m_flows.push_back (flow);
+  return m_flows.size () - 1;
+}
+
+inline void
+MultiFlowSender::ChangeRate (uint32_t flow, DataRate rate)
+{
+  NS_ABORT_MSG_IF (rate.GetBitRate () == 0, "MultiFlowSender::ChangeRate with a zero rate");
+  m_flows[flow].rate = rate;
+}
+
+inline uint32_t
+MultiFlowSender::GetNFlows (void) const
+{
+  return m_flows.size ();
+}
+
+inline uint32_t
+MultiFlowSender::GetPacketsSent (uint32_t flow) const
+{
+  return m_flows[flow].packetsSent;
+}
+
+inline uint32_t
+MultiFlowSender::GetSendFailures (uint32_t flow) const
+{
+  return m_flows[flow].sendFailures;
+}
+
+inline uint64_t
+MultiFlowSender::ToTick (Time t) const
+{
+  int64_t g = m_granularity.GetTimeStep ();
+  return (t.GetTimeStep () + g - 1) / g;
+}
+
+inline void
+MultiFlowSender::StartApplication (void)
+{
+  NS_ABORT_MSG_IF ((m_nSlots & (m_nSlots - 1)) != 0, "MultiFlowSender::Slots must be a power of two");
+  m_slots.assign (m_nSlots, NONE);
+  m_occupied.assign (m_nSlots / 64, 0);
+  m_queued = 0;
+  m_cursor = ToTick (Simulator::Now ());
+  m_running = true;
+
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      Flow &flow = m_flows[i];
+      flow.packetsSent = 0;
+      flow.sendFailures = 0;
+      if (InetSocketAddress::IsMatchingType (flow.peer))
+        {
+          flow.socket->Bind ();
+        }
+      else
+        {
+          flow.socket->Bind6 ();
+        }
+      flow.socket->Connect (flow.peer);
+      flow.deadline = Simulator::Now () + flow.startOffset;
+      Insert (i);
+    }
+  Arm ();
+}
+
+inline void
+MultiFlowSender::StopApplication (void)
+{
+  m_running = false;
+  Simulator::Cancel (m_event);
+  m_slots.clear ();
+  m_occupied.clear ();
+  m_queued = 0;
+
+  for (std::vector<Flow>::iterator it = m_flows.begin (); it != m_flows.end (); ++it)
+    {
+      if (it->socket)
+        {
+          it->socket->Close ();
+        }
+    }
+}
+
+inline void
+MultiFlowSender::Link (uint32_t slot, uint32_t flow)
+{
+  m_flows[flow].next = m_slots[slot];
+  m_slots[slot] = flow;
+  m_occupied[slot / 64] |= uint64_t (1) << (slot % 64);
+}
+
+inline void
+MultiFlowSender::Insert (uint32_t flow)
+{
+  Flow &f = m_flows[flow];
+  f.tick = std::max (ToTick (f.deadline), m_cursor);
+  Link (f.tick & (m_nSlots - 1), flow);
+  ++m_queued;
+}
+
+inline uint32_t
+MultiFlowSender::NextOccupied (uint32_t slot) const
+{
+  uint32_t nWords = m_occupied.size ();
+  uint32_t word = slot / 64;
+  uint64_t bits = m_occupied[word] & (~uint64_t (0) << (slot % 64));
+  for (uint32_t i = 0; i <= nWords; ++i)
+    {
+      if (bits != 0)
+        {
+          uint32_t found = ((word * 64) + __builtin_ctzll (bits));
+          return (found - slot) & (m_nSlots - 1);
+        }
+      word = (word + 1) % nWords;
+      bits = m_occupied[word];
+    }
+  return m_nSlots;
+}
+
+inline bool
+MultiFlowSender::FindNext (uint64_t &tick) const
+{
+  if (m_queued == 0)
+    {
+      return false;
+    }
+
+  // Walk the occupied slots of one revolution in tick order; the first one
+  // holding a flow due in this revolution has the earliest deadline.
+  uint64_t t = m_cursor;
+  uint64_t horizon = m_cursor + m_nSlots;
+  while (t < horizon)
+    {
+      uint32_t distance = NextOccupied (t & (m_nSlots - 1));
+      if (distance == m_nSlots)
+        {
+          break;
+        }
+      t += distance;
+      if (t >= horizon)
+        {
+          break;
+        }
+      for (uint32_t f = m_slots[t & (m_nSlots - 1)]; f != NONE; f = m_flows[f].next)
+        {
+          if (m_flows[f].tick <= t)
+            {
+              tick = t;
+              return true;
+            }
+        }
+      ++t;
+    }
+
+  // Everything is more than a revolution away.
+  tick = std::numeric_limits<uint64_t>::max ();
+  for (uint32_t s = 0; s < m_nSlots; ++s)
+    {
+      for (uint32_t f = m_slots[s]; f != NONE; f = m_flows[f].next)
+        {
+          tick = std::min (tick, m_flows[f].tick);
+        }
+    }
+  return true;
+}
+
+inline void
+MultiFlowSender::Arm (void)
+{
+  uint64_t tick;
+  if (!m_running || !FindNext (tick))
+    {
+      Simulator::Cancel (m_event);
+      return;
+    }
+  if (m_event.IsRunning () && m_eventTick == tick)
+    {
+      return;
+    }
+  Simulator::Cancel (m_event);
+  m_eventTick = tick;
+  Time at = TimeStep (m_granularity.GetTimeStep () * tick);
+  m_event = Simulator::Schedule (std::max (at - Simulator::Now (), Time (0)), &MultiFlowSender::Expire, this);
+}
+
+inline void
+MultiFlowSender::Expire (void)
+{
+  uint64_t now = m_eventTick;
+  uint32_t slot = now & (m_nSlots - 1);
+  m_cursor = now;
+
+  // Split the slot into the flows due now and those of later revolutions.
+  uint32_t due = NONE;
+  uint32_t f = m_slots[slot];
+  m_slots[slot] = NONE;
+  m_occupied[slot / 64] &= ~(uint64_t (1) << (slot % 64));
+  while (f != NONE)
+    {
+      uint32_t next = m_flows[f].next;
+      if (m_flows[f].tick <= now)
+        {
+          m_flows[f].next = due;
+          due = f;
+          --m_queued;
+        }
+      else
+        {
+          Link (slot, f);
+        }
+      f = next;
+    }
+
+  while (due != NONE)
+    {
+      uint32_t next = m_flows[due].next;
+      Flow &flow = m_flows[due];
+      // A refused packet is lost, not retried; only accepted ones count
+      // towards nPackets.
+      if (flow.socket->Send (flow.payload->Copy ()) < 0)
+        {
+          ++flow.sendFailures;
+        }
+      else
+        {
+          ++flow.packetsSent;
+        }
+      if (flow.nPackets == 0 || flow.packetsSent < flow.nPackets)
+        {
+          flow.deadline += flow.rate.CalculateBytesTxTime (flow.payload->GetSize ());
+          Insert (due);
+        }
+      due = next;
+    }
+  Arm ();
+}
+
+} // namespace ns3
+
+#endif /* MULTI_FLOW_SENDER_H */
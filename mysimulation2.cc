@@ -92,6 +92,11 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#include "throughput-histogram.h"
+#include "dumbbell-builder.h"
+#include "cwnd-compressor.h"
+#include "traced-tcp-socket-factory.h"
+#include "flow-report.h"
 
 using namespace ns3;
 
@@ -99,33 +104,9 @@ NS_LOG_COMPONENT_DEFINE("My Simulation 2");
 
 std::ofstream cwndStream;
 std::ofstream DataRateStream;
-static void
-CwndTracer(uint32_t oldval, uint32_t newval)
-{
-    cwndStream << std::fixed << std::setprecision(6) << Simulator::Now().GetSeconds() << std::setw(12) << newval << std::endl;
-}
+Ptr<CwndCompressor> cwndTracer; /* Writes the change points of the window to cwndStream */
 
 Ptr<PacketSink> sink, sink1;     /* Pointer to the packet sink application */
-uint64_t lastTotalRx = 0, lastTotalRx1 = 0; /* The value of the last total received bytes */
-
-void CalculateThroughput()
-{
-    Time now = Simulator::Now();                                        /* Return the simulator's virtual time. */
-    double cur = (sink->GetTotalRx() - lastTotalRx) * (double)8 / 1024; /* Convert Application RX Packets to KBits. */
-    double cur2 = (sink1->GetTotalRx() - lastTotalRx1) * (double)8 / 1024;
-    //std::cout << now.GetSeconds() << "s: \t" << cur << " Kbit/s" << std::endl;
-    std::cout << now.GetSeconds() << "s: \t" << (cur + cur2)/2 << " Kbit/s" << std::endl;
-    if(((cur+cur2)/2) != 0)
-    DataRateStream << std::fixed << std::setprecision(6) << Simulator::Now().GetSeconds() << std::setw(12) << (cur+cur2)/2 << std::endl;
-    lastTotalRx = sink->GetTotalRx();
-    lastTotalRx1 = sink1->GetTotalRx();
-    Simulator::Schedule(MilliSeconds(500), &CalculateThroughput);
-}
-
-void ConnectSocketTraces(void)
-{
-    Config::ConnectWithoutContext("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", MakeCallback(&CwndTracer));
-}
 
 int main(int argc, char *argv[])
 {
@@ -135,9 +116,6 @@ int main(int argc, char *argv[])
     std::string transportProtocol = "ns3::TcpNewAIMD";
     //std::string transportProtocol = "ns3::TcpNewReno";
 
-    uint32_t SentPackets = 0;
-    uint32_t ReceivedPackets = 0;
-    uint32_t LostPackets = 0;
 
     Time simulationEndTime = Seconds(20);
     DataRate bottleneckBandwidth("5Mbps"); // value of x as shown in the above network topology
@@ -152,63 +130,35 @@ int main(int argc, char *argv[])
     Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TypeId::LookupByName(transportProtocol)));
     Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(5));
 
-    NS_LOG_INFO("Create nodes.");
-    NodeContainer c;
-    c.Create(6);
-
-    NS_LOG_INFO("Create channels.");
-    NodeContainer n0n2 = NodeContainer(c.Get(0), c.Get(2));
-    NodeContainer n1n2 = NodeContainer(c.Get(1), c.Get(2));
-
-    NodeContainer n2n3 = NodeContainer(c.Get(2), c.Get(3));
-
-    NodeContainer n3n4 = NodeContainer(c.Get(3), c.Get(4));
-    NodeContainer n3n5 = NodeContainer(c.Get(3), c.Get(5));
-
+    NS_LOG_INFO("Create nodes and channels.");
     // Define Node link properties
     PointToPointHelper regLink;
     regLink.SetDeviceAttribute("DataRate", DataRateValue(regLinkBandwidth));
     regLink.SetChannelAttribute("Delay", TimeValue(regLinkDelay));
 
-    NetDeviceContainer d0d2 = regLink.Install(n0n2);
-    NetDeviceContainer d1d2 = regLink.Install(n1n2);
-    NetDeviceContainer d3d4 = regLink.Install(n3n4);
-    NetDeviceContainer d3d5 = regLink.Install(n3n5);
-
     PointToPointHelper bottleNeckLink;
     bottleNeckLink.SetDeviceAttribute("DataRate", DataRateValue(bottleneckBandwidth));
     bottleNeckLink.SetChannelAttribute("Delay", TimeValue(bottleneckDelay));
 
-    NetDeviceContainer d2d3 = bottleNeckLink.Install(n2n3);
+    // Two senders n0, n1 behind router n2 and two sinks n4, n5 behind n3
+    DumbbellBuilder dumbbell(regLink, bottleNeckLink);
+    dumbbell.Build(2, 2);
 
     // Install Internet stack
     InternetStackHelper stack;
-    stack.Install(c);
+    dumbbell.InstallStack(stack);
 
     // Install traffic control
     if (useQueueDisc)
     {
         TrafficControlHelper tchBottleneck;
         tchBottleneck.SetRootQueueDisc("ns3::FqCoDelQueueDisc");
-        tchBottleneck.Install(d2d3);
+        tchBottleneck.Install(dumbbell.GetBottleneckDevices());
     }
 
     NS_LOG_INFO("Assign IP Addresses.");
-    Ipv4AddressHelper ipv4;
-    ipv4.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface0 = ipv4.Assign(d0d2);
-
-    ipv4.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface1 = ipv4.Assign(d1d2);
-
-    ipv4.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer bottleneckInterface = ipv4.Assign(d2d3);
-
-    ipv4.SetBase("10.1.4.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface4 = ipv4.Assign(d3d4);
-
-    ipv4.SetBase("10.1.5.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface5 = ipv4.Assign(d3d5);
+    // 10.1.1.0/24 to 10.1.5.0/24: n0-n2, n1-n2, n2-n3, n3-n4, n3-n5
+    dumbbell.AssignIpv4Addresses("10.1.1.0", "255.255.255.0");
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
@@ -216,13 +166,13 @@ int main(int argc, char *argv[])
 
     // Two Sink Applications at n4 and n5
     uint16_t sinkPort = 8080;
-    Address sinkAddress4(InetSocketAddress(regLinkInterface4.GetAddress(1), sinkPort)); // interface of n4
-    Address sinkAddress5(InetSocketAddress(regLinkInterface5.GetAddress(1), sinkPort)); // interface of n5
-    Address sinkAddress3(InetSocketAddress(bottleneckInterface.GetAddress(1), sinkPort)); // interface of n5
+    Address sinkAddress4(InetSocketAddress(dumbbell.GetRightIpv4Address(0), sinkPort)); // interface of n4
+    Address sinkAddress5(InetSocketAddress(dumbbell.GetRightIpv4Address(1), sinkPort)); // interface of n5
+    Address sinkAddress3(InetSocketAddress(dumbbell.GetRightRouterIpv4Address(), sinkPort)); // interface of n5
     PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
-    ApplicationContainer sinkApps4 = packetSinkHelper.Install(c.Get(4)); // n4 as sink
-    ApplicationContainer sinkApps5 = packetSinkHelper.Install(c.Get(5)); // n5 as sink
-    ApplicationContainer sinkApps3 = packetSinkHelper.Install(c.Get(3)); // n5 as sink
+    ApplicationContainer sinkApps4 = packetSinkHelper.Install(dumbbell.GetRight(0)); // n4 as sink
+    ApplicationContainer sinkApps5 = packetSinkHelper.Install(dumbbell.GetRight(1)); // n5 as sink
+    ApplicationContainer sinkApps3 = packetSinkHelper.Install(dumbbell.GetRightRouter()); // n5 as sink
     sink = StaticCast<PacketSink>(sinkApps4.Get(0));                     // this is to monitor the data rate
      sink1 = StaticCast<PacketSink>(sinkApps5.Get(0));                     // this is to monitor the data rate
 
@@ -236,13 +186,13 @@ int main(int argc, char *argv[])
     uniformRv->SetStream(0);
 
     // Two Source Applications at n0 and n1
-    BulkSendHelper source0("ns3::TcpSocketFactory", sinkAddress4);
+    BulkSendHelper source0("ns3::TracedTcpSocketFactory", sinkAddress4); // traced at socket creation
     BulkSendHelper source1("ns3::TcpSocketFactory", sinkAddress5);
     // Set the amount of data to send in bytes.  Zero is unlimited.
     source0.SetAttribute("MaxBytes", UintegerValue(maxBytes));
     source1.SetAttribute("MaxBytes", UintegerValue(maxBytes));
-    ApplicationContainer sourceApps0 = source0.Install(c.Get(0));
-    ApplicationContainer sourceApps1 = source1.Install(c.Get(1));
+    ApplicationContainer sourceApps0 = source0.Install(dumbbell.GetLeft(0));
+    ApplicationContainer sourceApps1 = source1.Install(dumbbell.GetLeft(1));
 
     sourceApps0.Start(MicroSeconds(uniformRv->GetInteger(0, 1000)));
     sourceApps0.Stop(simulationEndTime);
@@ -257,12 +207,18 @@ int main(int argc, char *argv[])
     }
 
     cwndStream.open("AIMDcwnd.dat", std::ios::out);
+    cwndTracer = Create<CwndCompressor>(&cwndStream);
+    cwndTracer->SetErrorBound(1000);
     DataRateStream.open("AIMDdata.dat", std::ios::out);
 
     // cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
 
-    Simulator::Schedule(MicroSeconds(1001), &ConnectSocketTraces);
-    Simulator::Schedule(Seconds(1.1), &CalculateThroughput);
+    // The window of n0's socket is hooked when BulkSend creates it
+    TracedTcpSocketFactory::Install(dumbbell.GetLeft(0))->SetCwndCallback(MakeCallback(&CwndCompressor::CwndChange, cwndTracer));
+    // Rx accounting for both sinks, read back after the run
+    Ptr<ThroughputHistogram> histogram = CreateObject<ThroughputHistogram>();
+    histogram->Add(sink);
+    histogram->Add(sink1);
 
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
@@ -270,43 +226,30 @@ int main(int argc, char *argv[])
     NS_LOG_INFO("Run Simulation.");
     Simulator::Stop(simulationEndTime);
     Simulator::Run();
+    cwndTracer->Flush();
 
-    int j = 0;
-    float AvgThroughput = 0;
-
-    monitor->CheckForLostPackets();
-    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
-    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i)
+    // Average Kbit/s of the two flows every 500 ms, to the console and the
+    // data file; the old polling loop printed Kbit per 500 ms instead
+    std::vector<double> rate0 = histogram->GetThroughput(0, MilliSeconds(500), Seconds(1), simulationEndTime);
+    std::vector<double> rate1 = histogram->GetThroughput(1, MilliSeconds(500), Seconds(1), simulationEndTime);
+    for (uint32_t k = 0; k < rate0.size(); k++)
     {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-
-        std::cout << "Flow " << i->first << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-        std::cout << "  Tx Packets: " << i->second.txPackets << "\n";
-        std::cout << "  Tx Bytes:   " << i->second.txBytes << "\n";
-        std::cout << "  TxOffered:  " << i->second.txBytes * 8.0 / simulationEndTime.GetSeconds() / 1000 / 1000 << " Mbps\n";
-        std::cout << "  Rx Packets: " << i->second.rxPackets << "\n";
-        std::cout << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-        std::cout << "Lost Packets =" << i->second.txPackets - i->second.rxPackets << "\n";
-        std::cout << "Packet delivery ratio =" << i->second.rxPackets * 100 / i->second.txPackets << "%\n";
-        std::cout << "Packet loss ratio =" << (i->second.txPackets - i->second.rxPackets) * 100 / i->second.txPackets << "%\n";
-        std::cout <<  "Throughput: " << i->second.rxBytes * 8.0 / simulationEndTime.GetSeconds() / 1000 / 1000 << " Mbps\n";
-        AvgThroughput = AvgThroughput + i->second.rxBytes * 8.0 / simulationEndTime.GetSeconds() / 1000 / 1000;
-        SentPackets = SentPackets + (i->second.txPackets);
-        ReceivedPackets = ReceivedPackets + (i->second.rxPackets);
-        LostPackets = LostPackets + (i->second.txPackets - i->second.rxPackets);
-        j = j + 1;
+        double cur = (rate0[k] + rate1[k]) / 2 / 1024;
+        std::cout << 1.5 + 0.5 * k << "s: \t" << cur << " Kbit/s" << std::endl;
+        if (cur != 0)
+            DataRateStream << std::fixed << std::setprecision(6) << 1.5 + 0.5 * k << std::setw(12) << cur << "\n";
     }
 
-    AvgThroughput = AvgThroughput / j;
-    std::cout<<"--------Total Results of the simulation----------" << std::endl;
-    std::cout<<"Total sent packets  =" << SentPackets<<"\n";
-    std::cout<<"Total Received Packets =" << ReceivedPackets;
-    std::cout<<"Total Lost Packets =" << LostPackets;
-    std::cout<<"Packet Loss ratio =" << ((LostPackets * 100) / SentPackets) << "%\n";
-    std::cout<<"Packet delivery ratio =" << ((ReceivedPackets * 100) / SentPackets) << "%\n";
-    std::cout<<"Average Throughput =" << AvgThroughput << "Mbps\n";
-
+    monitor->CheckForLostPackets();
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    FlowReport report;
+    report.SetUnit(1e6, "Mbps");
+    report.SetDuration(simulationEndTime);
+    report.AddAll(monitor, classifier);
+    report.GroupBy([sinkPort](const FlowReport::FiveTuple &t) { return t.destinationPort == sinkPort ? "data" : "ack"; });
+    report.Compute();
+    report.Print(std::cout);
+    report.WriteCsv("AIMDflows.csv");
 
     // double averageThroughput = (((sink->GetTotalRx() * 8) / (1024 * simulationEndTime.GetSeconds())) + ((sink1->GetTotalRx() * 8) / (1024 * simulationEndTime.GetSeconds())))/2;
     // std::cout << "\nAverage throughput: " << averageThroughput << " Kbit/s" << std::endl;
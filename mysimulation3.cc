@@ -14,6 +14,9 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#include "throughput-histogram.h"
+#include "ipv4-subnet-allocator.h"
+#include "traced-tcp-socket-factory.h"
 
 using namespace ns3;
 
@@ -28,24 +31,6 @@ CwndTracer(uint32_t oldval, uint32_t newval)
 }
 
 Ptr<PacketSink> sink;     /* Pointer to the packet sink application */
-uint64_t lastTotalRx = 0; /* The value of the last total received bytes */
-
-void CalculateThroughput()
-{
-    Time now = Simulator::Now();                                        /* Return the simulator's virtual time. */
-    double cur = (sink->GetTotalRx() - lastTotalRx) * (double)8 / 1024; /* Convert Application RX Packets to KBits. */
-    //std::cout << now.GetSeconds() << "s: \t" << cur << " Kbit/s" << std::endl;
-    std::cout << now.GetSeconds() << "s: \t" << cur << " Kbit/s" << std::endl;
-    if(cur != 0)
-    DataRateStream << std::fixed << std::setprecision(6) << Simulator::Now().GetSeconds() << std::setw(12) << cur << std::endl;
-    lastTotalRx = sink->GetTotalRx();
-    Simulator::Schedule(MilliSeconds(500), &CalculateThroughput);
-}
-
-void ConnectSocketTraces(void)
-{
-    Config::ConnectWithoutContext("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", MakeCallback(&CwndTracer));
-}
 
 int main(int argc, char *argv[])
 {
@@ -111,17 +96,11 @@ int main(int argc, char *argv[])
     }
 
     NS_LOG_INFO("Assign IP Addresses.");
-    Ipv4AddressHelper ipv4;
-    ipv4.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface0 = ipv4.Assign(d0d1);
-
-    ipv4.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer bottleneckInterface = ipv4.Assign(d1d2);
-
-    ipv4.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer regLinkInterface1  = ipv4.Assign(d2d3);
-
-
+    // 10.1.1.0/24, 10.1.2.0/24 and 10.1.3.0/24 in the order of the links
+    NetDeviceContainer links(d0d1, d1d2);
+    links.Add(d2d3);
+    Ipv4SubnetAllocator ipv4("10.1.1.0", "255.255.0.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(links);
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
@@ -129,7 +108,7 @@ int main(int argc, char *argv[])
 
     // one Sink Applications at n3
     uint16_t sinkPort = 8080;
-    Address sinkAddress(InetSocketAddress(regLinkInterface1.GetAddress(1), sinkPort)); // interface of n4
+    Address sinkAddress(InetSocketAddress(interfaces.GetAddress(5), sinkPort)); // interface of n4
     PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
     ApplicationContainer sinkApps = packetSinkHelper.Install(c.Get(3)); // n4 as sink
     sink = StaticCast<PacketSink>(sinkApps.Get(0));                     // this is to monitor the data rate                   // this is to monitor the data rate
@@ -143,7 +122,7 @@ int main(int argc, char *argv[])
     uniformRv->SetStream(0);
 
     // Two Source Applications at n0 and n1
-    BulkSendHelper source0("ns3::TcpSocketFactory", sinkAddress);
+    BulkSendHelper source0("ns3::TracedTcpSocketFactory", sinkAddress); // traced at socket creation
     // Set the amount of data to send in bytes.  Zero is unlimited.
     source0.SetAttribute("MaxBytes", UintegerValue(maxBytes));
     ApplicationContainer sourceApps0 = source0.Install(c.Get(0));
@@ -163,8 +142,11 @@ int main(int argc, char *argv[])
 
     // cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
 
-    Simulator::Schedule(MicroSeconds(1001), &ConnectSocketTraces);
-    Simulator::Schedule(Seconds(1.1), &CalculateThroughput);
+    // The window of n0's socket is hooked when BulkSend creates it
+    TracedTcpSocketFactory::Install(c.Get(0))->SetCwndCallback(MakeCallback(&CwndTracer));
+    // Rx accounting for the sink, read back after the run
+    Ptr<ThroughputHistogram> histogram = CreateObject<ThroughputHistogram>();
+    histogram->Add(sink);
 
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
@@ -173,12 +155,23 @@ int main(int argc, char *argv[])
     Simulator::Stop(simulationEndTime);
     Simulator::Run();
 
+    // Kbit/s every 500 ms, to the console and the data file; the old
+    // polling loop printed Kbit per 500 ms instead
+    std::vector<double> rate = histogram->GetThroughput(0, MilliSeconds(500), Seconds(1), simulationEndTime);
+    for (uint32_t k = 0; k < rate.size(); k++)
+    {
+        double cur = rate[k] / 1024;
+        std::cout << 1.5 + 0.5 * k << "s: \t" << cur << " Kbit/s" << std::endl;
+        if (cur != 0)
+            DataRateStream << std::fixed << std::setprecision(6) << 1.5 + 0.5 * k << std::setw(12) << cur << "\n";
+    }
+
     int j = 0;
     float AvgThroughput = 0;
 
     monitor->CheckForLostPackets();
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+    const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats();
     for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i)
     {
         Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
@@ -22,6 +22,8 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ipv4-subnet-allocator.h"
+#include "parallel-global-routing.h"
 
 //       n0 ---+      +--- n2
 //             |      |
@@ -43,10 +45,14 @@ main (int argc, char *argv[])
 {
   bool verbose = true;
   uint32_t nCsma = 10;
+  uint32_t routingThreads = 0;
+  bool lazyRouting = false;
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("nCsma", "Number of \"extra\" CSMA nodes/devices", nCsma);
   cmd.AddValue ("verbose", "Tell echo applications to log if true", verbose);
+  cmd.AddValue ("routingThreads", "Threads for the route computation, 0 for one per core", routingThreads);
+  cmd.AddValue ("lazyRouting", "Resolve routes on the first packet instead of all at the start", lazyRouting);
 
   cmd.Parse (argc,argv);
 
@@ -99,31 +105,28 @@ main (int argc, char *argv[])
  
 
 
-  Ipv4AddressHelper address;
-  // left side
-  address.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer i0i4 = address.Assign (d0d4);
-  address.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer i1i4 = address.Assign (d1d4); 
-  address.SetBase ("10.1.6.0", "255.255.255.0");
-  Ipv4InterfaceContainer i6i4 = address.Assign (d6d4);
-  address.SetBase ("10.1.8.0", "255.255.255.0");
-  Ipv4InterfaceContainer i8i4 = address.Assign (d8d4);
-  //majher ta
-  address.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer i4i5 = address.Assign (d4d5);
-  //right side
-  address.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer i2i5 = address.Assign (d2d5);
-  address.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer i3i5 = address.Assign (d3d5);
-  address.SetBase ("10.1.7.0", "255.255.255.0");
-  Ipv4InterfaceContainer i7i5 = address.Assign (d7d5);
-  address.SetBase ("10.1.9.0", "255.255.255.0");
-  Ipv4InterfaceContainer i9i5 = address.Assign (d9d5);
+  // One /24 per link from 10.1.1.0: left side 1, 2, 6, 8, the middle
+  // link 3, right side 4, 5, 7, 9
+  NetDeviceContainer links (d0d4, d1d4);
+  links.Add (d4d5);
+  links.Add (d2d5);
+  links.Add (d3d5);
+  links.Add (d6d4);
+  links.Add (d7d5);
+  links.Add (d8d4);
+  links.Add (d9d5);
+  Ipv4SubnetAllocator address ("10.1.1.0", "255.255.0.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (links);
   
 
-  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  if (lazyRouting)
+    {
+      ParallelGlobalRouting::PopulateRoutingTablesOnDemand ();
+    }
+  else
+    {
+      ParallelGlobalRouting::PopulateRoutingTables (routingThreads);
+    }
   
   
 
@@ -133,7 +136,7 @@ main (int argc, char *argv[])
   serverApps.Start (Seconds (1.0));
   serverApps.Stop (Seconds (10.0));
 
-  UdpEchoClientHelper echoClient (i9i5.GetAddress(0), 9);
+  UdpEchoClientHelper echoClient (interfaces.GetAddress (16), 9); // n9
   echoClient.SetAttribute ("MaxPackets", UintegerValue (1));
   echoClient.SetAttribute ("Interval", TimeValue (Seconds (1.0)));
   echoClient.SetAttribute ("PacketSize", UintegerValue (1024));
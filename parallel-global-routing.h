@@ -0,0 +1,1024 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PARALLEL_GLOBAL_ROUTING_H
+#define PARALLEL_GLOBAL_ROUTING_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+// ===========================================================================
+//
+// A replacement for Ipv4GlobalRoutingHelper::PopulateRoutingTables on large
+// topologies.  Global routing builds link-state advertisements for every
+// router and runs an SPF from each in turn, then stores a list of network
+// routes at every node that is searched linearly per packet.
+//
+// ParallelRouteEngine reads the topology once into a compressed sparse row
+// graph: one vertex per node, one per multi-access subnet (a CSMA or Wi-Fi
+// channel shared by more than two devices), and an edge per interface with
+// the interface metric as its weight.  The SPFs from all nodes run on a
+// pool of threads that take sources from a shared counter; each one
+// touches only the graph and its own row of the result, so nothing is
+// locked.  The result is, for every (source, destination node) pair, the
+// distance and the edge that carries the first hop, eight bytes a pair.
+//
+// When an interface goes up or down after the start, the engine updates
+// only what changed.  A link that got worse can only change the routes of
+// sources whose shortest-path graph used it, and for those only the
+// destinations below it, which are rerun from their unaffected neighbours.
+// A link that got better is propagated outwards from its far end by a
+// Dijkstra that stops where nothing improves.
+//
+// In the on-demand mode nothing is computed up front.  The first packet
+// from a node to a destination runs one Dijkstra backwards from the
+// destination, stopping when it reaches the node, and caches the next hop
+// of every node on the path in a small per-node destination table, so the
+// packet is forwarded from the cache all the way.  Memory and setup time
+// then grow with the flows that actually run rather than with the square
+// of the nodes.  Any link change empties the caches.
+//
+// ParallelGlobalRouting is the per-node Ipv4RoutingProtocol that answers
+// from the engine.  It is added to each node's Ipv4ListRouting below static
+// routing, so directly connected subnets still go through the static
+// routes.
+//
+//   InternetStackHelper stack;
+//   stack.Install (nodes);
+//   ... assign addresses ...
+//   ParallelGlobalRouting::PopulateRoutingTables ();
+//   // or, for few flows on a large topology
+//   ParallelGlobalRouting::PopulateRoutingTablesOnDemand ();
+//   ...
+//   Simulator::Schedule (Seconds (5), &Ipv4::SetDown, ipv4, interface);
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Shortest paths between all nodes over a CSR graph, computed in
+ *        parallel and updated incrementally on link changes.
+ */
+class ParallelRouteEngine : public SimpleRefCount<ParallelRouteEngine>
+{
+public:
+  ParallelRouteEngine ();
+
+  /**
+   * \param threads the number of threads; zero uses one per hardware thread
+   */
+  void SetThreads (uint32_t threads);
+  /**
+   * \param lazy whether to resolve routes on their first lookup instead of
+   *        in ComputeAll; set before Build
+   */
+  void SetLazy (bool lazy);
+
+  /**
+   * Read all nodes, interfaces and addresses into the graph.
+   */
+  void Build (void);
+  /**
+   * Run an SPF from every node; not used in the on-demand mode.
+   */
+  void ComputeAll (void);
+  /**
+   * Re-read the state of an interface and its link, and update the routes
+   * of the sources it affects.
+   * \param node the node
+   * \param interface the interface that went up or down
+   * \return the number of sources whose routes were updated, or in the
+   *         on-demand mode whose caches were emptied
+   */
+  uint32_t NotifyLinkChange (Ptr<Node> node, uint32_t interface);
+
+  /**
+   * \param node the id of the node that routes
+   * \param destination the destination address
+   * \param interface the output interface
+   * \param gateway the next hop
+   * \return false if the destination is unknown, local or unreachable
+   */
+  bool Lookup (uint32_t node, Ipv4Address destination, uint32_t &interface, Ipv4Address &gateway);
+  /**
+   * Print the route of \p node to every known address, or in the
+   * on-demand mode to every address resolved so far.
+   * \param node the id of the node
+   * \param os the output stream
+   */
+  void Print (uint32_t node, std::ostream &os) const;
+
+  /**
+   * \return the number of vertices, nodes and multi-access subnets
+   */
+  uint32_t GetNVertices (void) const;
+  /**
+   * \return the number of directed edges
+   */
+  uint32_t GetNEdges (void) const;
+  /**
+   * \return the bytes used by the graph and the route tables or caches
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  enum { NONE = 0xffffffffU, INF = 0xffffffffU, NONE16 = 0xffffU };
+
+  /// A directed edge; node to node, node to subnet or subnet to node.
+  struct Edge
+  {
+    uint32_t tail;
+    uint32_t head;
+    uint32_t weight;    //!< the current weight, INF while down
+    uint32_t gateway;   //!< the address of the head on the link
+    uint16_t tailIf;    //!< the interface of the tail, NONE16 for a subnet
+    uint16_t headIf;    //!< the interface of the head, NONE16 for a subnet
+    uint16_t metric;    //!< the weight while up
+  };
+
+  /// A binary min-heap of (distance, vertex), kept with std::push_heap.
+  typedef std::vector<std::pair<uint32_t, uint32_t> > Heap;
+
+  /// A next hop in the cache of the on-demand mode.
+  struct CachedRoute
+  {
+    uint32_t gateway;
+    uint32_t distance;
+    uint16_t interface; //!< NONE16 if the destination is unreachable
+  };
+
+  typedef std::unordered_map<uint32_t, CachedRoute> RouteCache;  //!< by destination vertex
+
+  /// Per-thread working memory.
+  struct Scratch
+  {
+    Heap heap;
+    std::vector<uint8_t> mark;
+    std::vector<uint32_t> list;
+  };
+
+  uint32_t CurrentWeight (const Edge &edge) const;
+  uint32_t FirstHop (uint32_t source, const uint32_t *hop, uint32_t tail, uint32_t edge) const;
+  void Dijkstra (uint32_t source, Heap &heap);
+  void Spf (uint32_t source, Scratch &scratch);
+  bool UpdateWorse (uint32_t source, uint32_t edge, uint32_t oldWeight, Scratch &scratch);
+  bool UpdateBetter (uint32_t source, uint32_t edge, Scratch &scratch);
+  uint32_t RunParallel (std::function<bool (uint32_t, Scratch &)> task);
+  uint32_t GetThreads (void) const;
+  void Resolve (uint32_t node, uint32_t destination);
+  bool GetRoute (uint32_t node, uint32_t destination, uint32_t &interface, Ipv4Address &gateway,
+                 uint32_t &distance) const;
+
+  uint32_t m_threads;
+  bool m_lazy;
+  uint32_t m_nNodes;
+  uint32_t m_nVertices;
+  std::vector<Ptr<Ipv4> > m_ipv4;              //!< by node id
+  std::vector<uint32_t> m_offset;              //!< out-edges of v are [m_offset[v], m_offset[v + 1])
+  std::vector<Edge> m_edges;
+  std::vector<uint32_t> m_inOffset;            //!< in-edges of v are [m_inOffset[v], m_inOffset[v + 1])
+  std::vector<uint32_t> m_inEdges;             //!< indexes into m_edges
+  std::unordered_map<uint32_t, uint32_t> m_addressToVertex;
+  std::vector<std::pair<uint32_t, uint32_t> > m_addresses;  //!< (address, node), sorted
+  // Row s of each: the distance from node s to every vertex, and the edge
+  // that gives the gateway of the first hop.
+  std::vector<uint32_t> m_dist;
+  std::vector<uint32_t> m_hop;
+  // On-demand mode: the cache of each node, and the distance to the
+  // destination and next edge of each vertex while resolving.
+  std::vector<RouteCache> m_cache;
+  std::vector<uint32_t> m_toDist;
+  std::vector<uint32_t> m_toNext;
+  Scratch m_scratch;
+};
+
+/**
+ * \brief Routes unicast packets along the paths of a ParallelRouteEngine.
+ */
+class ParallelGlobalRouting : public Ipv4RoutingProtocol
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  ParallelGlobalRouting ();
+  virtual ~ParallelGlobalRouting ();
+
+  /**
+   * Build an engine over all nodes, compute all routes, and add a
+   * ParallelGlobalRouting to the Ipv4ListRouting of every node.
+   * \param threads the number of threads; zero uses one per hardware thread
+   * \return the engine
+   */
+  static Ptr<ParallelRouteEngine> PopulateRoutingTables (uint32_t threads = 0);
+  /**
+   * Build an engine over all nodes that resolves routes on their first
+   * lookup, and add a ParallelGlobalRouting to the Ipv4ListRouting of
+   * every node.
+   * \return the engine
+   */
+  static Ptr<ParallelRouteEngine> PopulateRoutingTablesOnDemand (void);
+
+  /**
+   * \param engine the engine to take routes from
+   */
+  void SetEngine (Ptr<ParallelRouteEngine> engine);
+
+  // Inherited from Ipv4RoutingProtocol
+  virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                                      Socket::SocketErrno &sockerr);
+  virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                           UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                           LocalDeliverCallback lcb, ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface);
+  virtual void NotifyInterfaceDown (uint32_t interface);
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+  virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  static void Install (Ptr<ParallelRouteEngine> engine);
+  Ptr<Ipv4Route> Lookup (Ipv4Address destination, Ptr<const NetDevice> oif) const;
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<ParallelRouteEngine> m_engine;
+};
+
+inline
+ParallelRouteEngine::ParallelRouteEngine ()
+  : m_threads (0),
+    m_lazy (false),
+    m_nNodes (0),
+    m_nVertices (0)
+{
+}
+
+inline void
+ParallelRouteEngine::SetThreads (uint32_t threads)
+{
+  m_threads = threads;
+}
+
+inline void
+ParallelRouteEngine::SetLazy (bool lazy)
+{
+  m_lazy = lazy;
+}
+
+inline uint32_t
+ParallelRouteEngine::GetThreads (void) const
+{
+  return m_threads > 0 ? m_threads : std::max (1u, std::thread::hardware_concurrency ());
+}
+
+inline uint32_t
+ParallelRouteEngine::CurrentWeight (const Edge &edge) const
+{
+  if ((edge.tailIf != NONE16 && !m_ipv4[edge.tail]->IsUp (edge.tailIf))
+      || (edge.headIf != NONE16 && !m_ipv4[edge.head]->IsUp (edge.headIf)))
+    {
+      return INF;
+    }
+  return edge.metric;
+}
+
+inline void
+ParallelRouteEngine::Build (void)
+{
+  m_nNodes = NodeList::GetNNodes ();
+  m_ipv4.assign (m_nNodes, Ptr<Ipv4> ());
+  m_addressToVertex.clear ();
+  m_addresses.clear ();
+
+  // A channel with more than two devices becomes one vertex per subnet on
+  // it, so that stations of different BSSs on one Wi-Fi channel stay apart.
+  std::unordered_map<uint64_t, uint32_t> subnets;
+  std::vector<Edge> edges;
+  m_nVertices = m_nNodes;
+  for (uint32_t n = 0; n < m_nNodes; ++n)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (n)->GetObject<Ipv4> ();
+      m_ipv4[n] = ipv4;
+      if (ipv4 == 0)
+        {
+          continue;
+        }
+      for (uint32_t i = 1; i < ipv4->GetNInterfaces (); ++i)
+        {
+          for (uint32_t a = 0; a < ipv4->GetNAddresses (i); ++a)
+            {
+              Ipv4Address local = ipv4->GetAddress (i, a).GetLocal ();
+              m_addressToVertex[local.Get ()] = n;
+              m_addresses.push_back (std::make_pair (local.Get (), n));
+            }
+          Ptr<NetDevice> device = ipv4->GetNetDevice (i);
+          Ptr<Channel> channel = device->GetChannel ();
+          if (channel == 0 || ipv4->GetNAddresses (i) == 0)
+            {
+              continue;
+            }
+          Ipv4InterfaceAddress address = ipv4->GetAddress (i, 0);
+          uint16_t metric = std::max<uint16_t> (ipv4->GetMetric (i), 1);
+          if (channel->GetNDevices () == 2)
+            {
+              Ptr<NetDevice> peer = channel->GetDevice (channel->GetDevice (0) == device ? 1 : 0);
+              Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+              int32_t peerIf = peerIpv4 != 0 ? peerIpv4->GetInterfaceForDevice (peer) : -1;
+              if (peerIf < 0 || peerIpv4->GetNAddresses (peerIf) == 0)
+                {
+                  continue;
+                }
+              Edge edge = { n, peer->GetNode ()->GetId (), INF,
+                            peerIpv4->GetAddress (peerIf, 0).GetLocal ().Get (),
+                            uint16_t (i), uint16_t (peerIf), metric };
+              edges.push_back (edge);
+            }
+          else
+            {
+              uint64_t key = (uint64_t (channel->GetId ()) << 32) | address.GetLocal ().CombineMask (address.GetMask ()).Get ();
+              std::unordered_map<uint64_t, uint32_t>::iterator it = subnets.find (key);
+              if (it == subnets.end ())
+                {
+                  it = subnets.insert (std::make_pair (key, m_nVertices++)).first;
+                }
+              Edge toSubnet = { n, it->second, INF, 0, uint16_t (i), NONE16, metric };
+              Edge fromSubnet = { it->second, n, INF, address.GetLocal ().Get (), NONE16, uint16_t (i), 0 };
+              edges.push_back (toSubnet);
+              edges.push_back (fromSubnet);
+            }
+        }
+    }
+  std::sort (m_addresses.begin (), m_addresses.end ());
+
+  // Counting sort of the edges by tail, then the in-edge index by head
+  m_offset.assign (m_nVertices + 1, 0);
+  m_inOffset.assign (m_nVertices + 1, 0);
+  for (uint32_t e = 0; e < edges.size (); ++e)
+    {
+      m_offset[edges[e].tail + 1]++;
+      m_inOffset[edges[e].head + 1]++;
+    }
+  for (uint32_t v = 0; v < m_nVertices; ++v)
+    {
+      m_offset[v + 1] += m_offset[v];
+      m_inOffset[v + 1] += m_inOffset[v];
+    }
+  m_edges.resize (edges.size ());
+  m_inEdges.resize (edges.size ());
+  std::vector<uint32_t> fill (m_offset.begin (), m_offset.end () - 1);
+  for (uint32_t e = 0; e < edges.size (); ++e)
+    {
+      m_edges[fill[edges[e].tail]++] = edges[e];
+    }
+  fill.assign (m_inOffset.begin (), m_inOffset.end () - 1);
+  for (uint32_t e = 0; e < m_edges.size (); ++e)
+    {
+      m_edges[e].weight = CurrentWeight (m_edges[e]);
+      m_inEdges[fill[m_edges[e].head]++] = e;
+    }
+
+  m_cache.clear ();
+  if (m_lazy)
+    {
+      m_cache.resize (m_nNodes);
+      m_toDist.assign (m_nVertices, INF);
+      m_toNext.assign (m_nVertices, NONE);
+    }
+}
+
+inline uint32_t
+ParallelRouteEngine::FirstHop (uint32_t source, const uint32_t *hop, uint32_t tail, uint32_t edge) const
+{
+  // Leaving the source, or leaving a subnet the source is on, the edge
+  // itself names the gateway; further out the first hop is inherited.
+  if (tail == source
+      || (tail >= m_nNodes && hop[tail] != NONE
+          && m_edges[hop[tail]].tail == source && m_edges[hop[tail]].head == tail))
+    {
+      return edge;
+    }
+  return hop[tail];
+}
+
+inline void
+ParallelRouteEngine::Dijkstra (uint32_t source, Heap &heap)
+{
+  uint32_t *dist = &m_dist[uint64_t (source) * m_nVertices];
+  uint32_t *hop = &m_hop[uint64_t (source) * m_nVertices];
+  std::greater<std::pair<uint32_t, uint32_t> > later;
+  while (!heap.empty ())
+    {
+      std::pop_heap (heap.begin (), heap.end (), later);
+      uint32_t d = heap.back ().first;
+      uint32_t u = heap.back ().second;
+      heap.pop_back ();
+      if (d != dist[u])
+        {
+          continue;
+        }
+      for (uint32_t e = m_offset[u]; e < m_offset[u + 1]; ++e)
+        {
+          const Edge &edge = m_edges[e];
+          if (edge.weight == INF || d + edge.weight >= dist[edge.head])
+            {
+              continue;
+            }
+          dist[edge.head] = d + edge.weight;
+          hop[edge.head] = FirstHop (source, hop, u, e);
+          heap.push_back (std::make_pair (dist[edge.head], edge.head));
+          std::push_heap (heap.begin (), heap.end (), later);
+        }
+    }
+}
+
+inline void
+ParallelRouteEngine::Spf (uint32_t source, Scratch &scratch)
+{
+  uint32_t *dist = &m_dist[uint64_t (source) * m_nVertices];
+  uint32_t *hop = &m_hop[uint64_t (source) * m_nVertices];
+  std::fill (dist, dist + m_nVertices, INF);
+  std::fill (hop, hop + m_nVertices, NONE);
+  dist[source] = 0;
+  scratch.heap.assign (1, std::make_pair (0u, source));
+  Dijkstra (source, scratch.heap);
+}
+
+inline bool
+ParallelRouteEngine::UpdateWorse (uint32_t source, uint32_t edge, uint32_t oldWeight, Scratch &scratch)
+{
+  uint32_t *dist = &m_dist[uint64_t (source) * m_nVertices];
+  uint32_t *hop = &m_hop[uint64_t (source) * m_nVertices];
+  const Edge &changed = m_edges[edge];
+  if (dist[changed.tail] == INF || dist[changed.tail] + oldWeight != dist[changed.head])
+    {
+      return false;
+    }
+
+  // Everything below the head in the shortest-path graph may have used
+  // the edge; take it out and rerun Dijkstra over just that part, seeded
+  // from its neighbours outside, whose distances cannot have changed.
+  std::vector<uint8_t> &affected = scratch.mark;
+  std::vector<uint32_t> &list = scratch.list;
+  list.clear ();
+  list.push_back (changed.head);
+  affected[changed.head] = 1;
+  for (uint32_t k = 0; k < list.size (); ++k)
+    {
+      uint32_t u = list[k];
+      for (uint32_t e = m_offset[u]; e < m_offset[u + 1]; ++e)
+        {
+          const Edge &out = m_edges[e];
+          if (!affected[out.head] && out.weight != INF && dist[u] + out.weight == dist[out.head])
+            {
+              affected[out.head] = 1;
+              list.push_back (out.head);
+            }
+        }
+    }
+  for (uint32_t k = 0; k < list.size (); ++k)
+    {
+      dist[list[k]] = INF;
+      hop[list[k]] = NONE;
+    }
+
+  Heap &heap = scratch.heap;
+  heap.clear ();
+  for (uint32_t k = 0; k < list.size (); ++k)
+    {
+      uint32_t v = list[k];
+      for (uint32_t i = m_inOffset[v]; i < m_inOffset[v + 1]; ++i)
+        {
+          const Edge &in = m_edges[m_inEdges[i]];
+          if (affected[in.tail] || in.weight == INF || dist[in.tail] == INF
+              || dist[in.tail] + in.weight >= dist[v])
+            {
+              continue;
+            }
+          dist[v] = dist[in.tail] + in.weight;
+          hop[v] = FirstHop (source, hop, in.tail, m_inEdges[i]);
+        }
+      if (dist[v] != INF)
+        {
+          heap.push_back (std::make_pair (dist[v], v));
+        }
+    }
+  for (uint32_t k = 0; k < list.size (); ++k)
+    {
+      affected[list[k]] = 0;
+    }
+  std::make_heap (heap.begin (), heap.end (), std::greater<std::pair<uint32_t, uint32_t> > ());
+  Dijkstra (source, heap);
+  return true;
+}
+
+inline bool
+ParallelRouteEngine::UpdateBetter (uint32_t source, uint32_t edge, Scratch &scratch)
+{
+  uint32_t *dist = &m_dist[uint64_t (source) * m_nVertices];
+  uint32_t *hop = &m_hop[uint64_t (source) * m_nVertices];
+  const Edge &changed = m_edges[edge];
+  if (dist[changed.tail] == INF || dist[changed.tail] + changed.weight >= dist[changed.head])
+    {
+      return false;
+    }
+  dist[changed.head] = dist[changed.tail] + changed.weight;
+  hop[changed.head] = FirstHop (source, hop, changed.tail, edge);
+  scratch.heap.assign (1, std::make_pair (dist[changed.head], changed.head));
+  Dijkstra (source, scratch.heap);
+  return true;
+}
+
+inline uint32_t
+ParallelRouteEngine::RunParallel (std::function<bool (uint32_t, Scratch &)> task)
+{
+  // Sources differ a lot in cost, so the threads take them one at a time
+  // from a shared counter rather than in fixed ranges.
+  std::atomic<uint32_t> next (0);
+  std::atomic<uint32_t> changed (0);
+  uint32_t nNodes = m_nNodes;
+  uint32_t nVertices = m_nVertices;
+  std::function<void ()> worker = [&] ()
+    {
+      Scratch scratch;
+      scratch.mark.assign (nVertices, 0);
+      for (uint32_t s = next++; s < nNodes; s = next++)
+        {
+          if (task (s, scratch))
+            {
+              changed++;
+            }
+        }
+    };
+  uint32_t threads = std::min (GetThreads (), std::max (1u, nNodes));
+  std::vector<std::thread> workers;
+  for (uint32_t t = 1; t < threads; ++t)
+    {
+      workers.push_back (std::thread (worker));
+    }
+  worker ();
+  for (uint32_t t = 0; t < workers.size (); ++t)
+    {
+      workers[t].join ();
+    }
+  return changed;
+}
+
+inline void
+ParallelRouteEngine::ComputeAll (void)
+{
+  NS_ASSERT_MSG (!m_lazy, "ParallelRouteEngine::ComputeAll in the on-demand mode");
+  m_dist.assign (uint64_t (m_nNodes) * m_nVertices, INF);
+  m_hop.assign (uint64_t (m_nNodes) * m_nVertices, NONE);
+  RunParallel ([this] (uint32_t source, Scratch &scratch) { Spf (source, scratch); return true; });
+}
+
+inline uint32_t
+ParallelRouteEngine::NotifyLinkChange (Ptr<Node> node, uint32_t interface)
+{
+  // The edges out of the interface and into it; on a subnet also the
+  // other direction through the subnet vertex.
+  uint32_t n = node->GetId ();
+  std::vector<uint32_t> touched;
+  for (uint32_t e = m_offset[n]; e < m_offset[n + 1]; ++e)
+    {
+      if (m_edges[e].tailIf == interface)
+        {
+          touched.push_back (e);
+        }
+    }
+  for (uint32_t i = m_inOffset[n]; i < m_inOffset[n + 1]; ++i)
+    {
+      if (m_edges[m_inEdges[i]].headIf == interface)
+        {
+          touched.push_back (m_inEdges[i]);
+        }
+    }
+
+  uint32_t updated = 0;
+  if (m_lazy)
+    {
+      bool changed = false;
+      for (uint32_t k = 0; k < touched.size (); ++k)
+        {
+          uint32_t weight = CurrentWeight (m_edges[touched[k]]);
+          changed = changed || weight != m_edges[touched[k]].weight;
+          m_edges[touched[k]].weight = weight;
+        }
+      for (uint32_t v = 0; changed && v < m_nNodes; ++v)
+        {
+          if (!m_cache[v].empty ())
+            {
+              m_cache[v].clear ();
+              updated++;
+            }
+        }
+      return updated;
+    }
+  for (uint32_t k = 0; k < touched.size (); ++k)
+    {
+      uint32_t e = touched[k];
+      uint32_t oldWeight = m_edges[e].weight;
+      m_edges[e].weight = CurrentWeight (m_edges[e]);
+      if (m_edges[e].weight > oldWeight)
+        {
+          updated += RunParallel ([this, e, oldWeight] (uint32_t source, Scratch &scratch)
+                                    { return UpdateWorse (source, e, oldWeight, scratch); });
+        }
+      else if (m_edges[e].weight < oldWeight)
+        {
+          updated += RunParallel ([this, e] (uint32_t source, Scratch &scratch)
+                                    { return UpdateBetter (source, e, scratch); });
+        }
+    }
+  return updated;
+}
+
+inline void
+ParallelRouteEngine::Resolve (uint32_t node, uint32_t destination)
+{
+  // Dijkstra over the in-edges from the destination, until the node is
+  // reached; then every vertex on the path knows its next edge.
+  uint32_t *dist = &m_toDist[0];
+  uint32_t *next = &m_toNext[0];
+  std::vector<uint32_t> &touched = m_scratch.list;
+  Heap &heap = m_scratch.heap;
+  std::greater<std::pair<uint32_t, uint32_t> > later;
+  touched.assign (1, destination);
+  dist[destination] = 0;
+  heap.assign (1, std::make_pair (0u, destination));
+  while (!heap.empty ())
+    {
+      std::pop_heap (heap.begin (), heap.end (), later);
+      uint32_t d = heap.back ().first;
+      uint32_t u = heap.back ().second;
+      heap.pop_back ();
+      if (u == node)
+        {
+          break;
+        }
+      if (d != dist[u])
+        {
+          continue;
+        }
+      for (uint32_t i = m_inOffset[u]; i < m_inOffset[u + 1]; ++i)
+        {
+          const Edge &edge = m_edges[m_inEdges[i]];
+          if (edge.weight == INF || d + edge.weight >= dist[edge.tail])
+            {
+              continue;
+            }
+          if (dist[edge.tail] == INF)
+            {
+              touched.push_back (edge.tail);
+            }
+          dist[edge.tail] = d + edge.weight;
+          next[edge.tail] = m_inEdges[i];
+          heap.push_back (std::make_pair (dist[edge.tail], edge.tail));
+          std::push_heap (heap.begin (), heap.end (), later);
+        }
+    }
+
+  // Later packets are forwarded by the nodes further down the path, so
+  // cache all of them now.  An unreachable destination is cached too, or
+  // every packet to it would search the whole graph again.
+  CachedRoute unreachable = { 0, INF, NONE16 };
+  m_cache[node][destination] = unreachable;
+  for (uint32_t v = node; dist[v] != INF && v != destination; v = m_edges[next[v]].head)
+    {
+      const Edge &edge = m_edges[next[v]];
+      if (v < m_nNodes)
+        {
+          // Onto a subnet, the gateway is the node the subnet leads to
+          uint32_t gateway = edge.head < m_nNodes ? edge.gateway : m_edges[next[edge.head]].gateway;
+          CachedRoute route = { gateway, dist[v], edge.tailIf };
+          m_cache[v][destination] = route;
+        }
+    }
+
+  for (uint32_t k = 0; k < touched.size (); ++k)
+    {
+      dist[touched[k]] = INF;
+      next[touched[k]] = NONE;
+    }
+  heap.clear ();
+}
+
+inline bool
+ParallelRouteEngine::GetRoute (uint32_t node, uint32_t destination, uint32_t &interface, Ipv4Address &gateway,
+                               uint32_t &distance) const
+{
+  if (m_lazy)
+    {
+      RouteCache::const_iterator it = m_cache[node].find (destination);
+      if (it == m_cache[node].end () || it->second.interface == NONE16)
+        {
+          return false;
+        }
+      interface = it->second.interface;
+      gateway = Ipv4Address (it->second.gateway);
+      distance = it->second.distance;
+      return true;
+    }
+
+  uint32_t h = m_hop[uint64_t (node) * m_nVertices + destination];
+  if (h == NONE)
+    {
+      return false;
+    }
+  const Edge &edge = m_edges[h];
+  gateway = Ipv4Address (edge.gateway);
+  distance = m_dist[uint64_t (node) * m_nVertices + destination];
+  if (edge.tail == node)
+    {
+      interface = edge.tailIf;
+      return true;
+    }
+  // The first hop crosses a subnet: the interface is the one onto it
+  for (uint32_t e = m_offset[node]; e < m_offset[node + 1]; ++e)
+    {
+      if (m_edges[e].head == edge.tail)
+        {
+          interface = m_edges[e].tailIf;
+          return true;
+        }
+    }
+  return false;
+}
+
+inline bool
+ParallelRouteEngine::Lookup (uint32_t node, Ipv4Address destination, uint32_t &interface, Ipv4Address &gateway)
+{
+  std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_addressToVertex.find (destination.Get ());
+  if (node >= m_nNodes || it == m_addressToVertex.end () || it->second == node)
+    {
+      return false;
+    }
+  if (m_lazy && m_cache[node].find (it->second) == m_cache[node].end ())
+    {
+      Resolve (node, it->second);
+    }
+  uint32_t distance;
+  return GetRoute (node, it->second, interface, gateway, distance);
+}
+
+inline void
+ParallelRouteEngine::Print (uint32_t node, std::ostream &os) const
+{
+  os << "Destination     Gateway         Interface  Distance" << std::endl;
+  for (uint32_t k = 0; k < m_addresses.size (); ++k)
+    {
+      uint32_t interface;
+      Ipv4Address gateway;
+      uint32_t distance;
+      if (m_addresses[k].second != node
+          && GetRoute (node, m_addresses[k].second, interface, gateway, distance))
+        {
+          std::ostringstream destination;
+          std::ostringstream next;
+          destination << Ipv4Address (m_addresses[k].first);
+          next << gateway;
+          os << std::left << std::setw (16) << destination.str () << std::setw (16) << next.str ()
+             << std::setw (11) << interface << distance << std::endl;
+        }
+    }
+}
+
+inline uint32_t
+ParallelRouteEngine::GetNVertices (void) const
+{
+  return m_nVertices;
+}
+
+inline uint32_t
+ParallelRouteEngine::GetNEdges (void) const
+{
+  return m_edges.size ();
+}
+
+inline uint64_t
+ParallelRouteEngine::GetMemoryUsage (void) const
+{
+  uint64_t bytes = m_edges.capacity () * sizeof (Edge)
+    + (m_offset.capacity () + m_inOffset.capacity () + m_inEdges.capacity ()) * sizeof (uint32_t)
+    + (m_dist.capacity () + m_hop.capacity () + m_toDist.capacity () + m_toNext.capacity ()) * sizeof (uint32_t)
+    + m_cache.capacity () * sizeof (RouteCache);
+  for (uint32_t n = 0; n < m_cache.size (); ++n)
+    {
+      // A bucket pointer each, and a node of key, route and next pointer
+      // per entry
+      bytes += m_cache[n].bucket_count () * sizeof (void *)
+        + m_cache[n].size () * (sizeof (RouteCache::value_type) + sizeof (void *));
+    }
+  return bytes;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (ParallelGlobalRouting);
+
+inline TypeId
+ParallelGlobalRouting::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ParallelGlobalRouting")
+    .SetParent<Ipv4RoutingProtocol> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<ParallelGlobalRouting> ()
+  ;
+  return tid;
+}
+
+inline
+ParallelGlobalRouting::ParallelGlobalRouting ()
+{
+}
+
+inline
+ParallelGlobalRouting::~ParallelGlobalRouting ()
+{
+}
+
+inline void
+ParallelGlobalRouting::DoDispose (void)
+{
+  m_ipv4 = 0;
+  m_engine = 0;
+  Ipv4RoutingProtocol::DoDispose ();
+}
+
+inline Ptr<ParallelRouteEngine>
+ParallelGlobalRouting::PopulateRoutingTables (uint32_t threads)
+{
+  Ptr<ParallelRouteEngine> engine = Create<ParallelRouteEngine> ();
+  engine->SetThreads (threads);
+  engine->Build ();
+  engine->ComputeAll ();
+  Install (engine);
+  return engine;
+}
+
+inline Ptr<ParallelRouteEngine>
+ParallelGlobalRouting::PopulateRoutingTablesOnDemand (void)
+{
+  Ptr<ParallelRouteEngine> engine = Create<ParallelRouteEngine> ();
+  engine->SetLazy (true);
+  engine->Build ();
+  Install (engine);
+  return engine;
+}
+
+inline void
+ParallelGlobalRouting::Install (Ptr<ParallelRouteEngine> engine)
+{
+  for (uint32_t n = 0; n < NodeList::GetNNodes (); ++n)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (n)->GetObject<Ipv4> ();
+      if (ipv4 == 0)
+        {
+          continue;
+        }
+      Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (ipv4->GetRoutingProtocol ());
+      NS_ABORT_MSG_UNLESS (list, "ParallelGlobalRouting needs Ipv4ListRouting on node " << n);
+      Ptr<ParallelGlobalRouting> routing = CreateObject<ParallelGlobalRouting> ();
+      routing->SetEngine (engine);
+      // Below static routing (0), above Ipv4GlobalRouting (-10)
+      list->AddRoutingProtocol (routing, -5);
+    }
+}
+
+inline void
+ParallelGlobalRouting::SetEngine (Ptr<ParallelRouteEngine> engine)
+{
+  m_engine = engine;
+}
+
+inline Ptr<Ipv4Route>
+ParallelGlobalRouting::Lookup (Ipv4Address destination, Ptr<const NetDevice> oif) const
+{
+  uint32_t interface;
+  Ipv4Address gateway;
+  if (m_engine == 0 || destination.IsMulticast () || destination.IsBroadcast ()
+      || !m_engine->Lookup (m_ipv4->GetObject<Node> ()->GetId (), destination, interface, gateway)
+      || (oif != 0 && m_ipv4->GetNetDevice (interface) != oif))
+    {
+      return 0;
+    }
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (destination);
+  route->SetGateway (gateway);
+  route->SetOutputDevice (m_ipv4->GetNetDevice (interface));
+  route->SetSource (m_ipv4->GetAddress (interface, 0).GetLocal ());
+  return route;
+}
+
+inline Ptr<Ipv4Route>
+ParallelGlobalRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                                    Socket::SocketErrno &sockerr)
+{
+  Ptr<Ipv4Route> route = Lookup (header.GetDestination (), oif);
+  sockerr = route != 0 ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+  return route;
+}
+
+inline bool
+ParallelGlobalRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                                   UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                                   LocalDeliverCallback lcb, ErrorCallback ecb)
+{
+  // Ipv4ListRouting has already delivered local packets
+  Ptr<Ipv4Route> route = Lookup (header.GetDestination (), 0);
+  if (route == 0)
+    {
+      return false;
+    }
+  if (!m_ipv4->IsForwarding (m_ipv4->GetInterfaceForDevice (idev)))
+    {
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+  ucb (route, p, header);
+  return true;
+}
+
+inline void
+ParallelGlobalRouting::NotifyInterfaceUp (uint32_t interface)
+{
+  // Interfaces come up during setup, before the engine exists
+  if (m_engine != 0 && Simulator::Now ().IsStrictlyPositive ())
+    {
+      m_engine->NotifyLinkChange (m_ipv4->GetObject<Node> (), interface);
+    }
+}
+
+inline void
+ParallelGlobalRouting::NotifyInterfaceDown (uint32_t interface)
+{
+  if (m_engine != 0)
+    {
+      m_engine->NotifyLinkChange (m_ipv4->GetObject<Node> (), interface);
+    }
+}
+
+inline void
+ParallelGlobalRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  // Addresses are read by ParallelRouteEngine::Build
+}
+
+inline void
+ParallelGlobalRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+inline void
+ParallelGlobalRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  m_ipv4 = ipv4;
+}
+
+inline void
+ParallelGlobalRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+  std::ostream *os = stream->GetStream ();
+  *os << "Node: " << m_ipv4->GetObject<Node> ()->GetId ()
+      << ", Time: " << Now ().As (unit)
+      << ", ParallelGlobalRouting table" << std::endl;
+  if (m_engine != 0)
+    {
+      m_engine->Print (m_ipv4->GetObject<Node> ()->GetId (), *os);
+    }
+  *os << std::endl;
+}
+
+} // namespace ns3
+
+#endif /* PARALLEL_GLOBAL_ROUTING_H */
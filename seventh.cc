@@ -21,6 +21,8 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/stats-module.h"
+#include "traffic-generator.h"
+#include "cwnd-compressor.h"
 
 using namespace ns3;
 
@@ -57,141 +59,13 @@ NS_LOG_COMPONENT_DEFINE ("SeventhScriptExample");
 //
 // So first, we create a socket and do the trace connect on it; then we pass
 // this socket into the constructor of our simple application which we then
-// install in the source node.
+// install in the source node.  That application is the ConstantRateGenerator
+// from traffic-generator.h.
 //
 // NOTE: If this example gets modified, do not forget to update the .png figure
 // in src/stats/docs/seventh-packet-byte-count.png
 // ===========================================================================
 //
-class MyApp : public Application
-{
-public:
-  MyApp ();
-  virtual ~MyApp ();
-
-  /**
-   * Register this type.
-   * \return The TypeId.
-   */
-  static TypeId GetTypeId (void);
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-};
-
-MyApp::MyApp ()
-  : m_socket (0),
-    m_peer (),
-    m_packetSize (0),
-    m_nPackets (0),
-    m_dataRate (0),
-    m_sendEvent (),
-    m_running (false),
-    m_packetsSent (0)
-{
-}
-
-MyApp::~MyApp ()
-{
-  m_socket = 0;
-}
-
-/* static */
-TypeId MyApp::GetTypeId (void)
-{
-  static TypeId tid = TypeId ("MyApp")
-    .SetParent<Application> ()
-    .SetGroupName ("Tutorial")
-    .AddConstructor<MyApp> ()
-    ;
-  return tid;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void
-MyApp::StartApplication (void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  if (InetSocketAddress::IsMatchingType (m_peer))
-    {
-      m_socket->Bind ();
-    }
-  else
-    {
-      m_socket->Bind6 ();
-    }
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
-
-void
-MyApp::StopApplication (void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
-    {
-      Simulator::Cancel (m_sendEvent);
-    }
-
-  if (m_socket)
-    {
-      m_socket->Close ();
-    }
-}
-
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
-
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
-}
-
-void
-MyApp::ScheduleTx (void)
-{
-  if (m_running)
-    {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
-    }
-}
-
-static void
-CwndChange (Ptr<OutputStreamWrapper> stream, uint32_t oldCwnd, uint32_t newCwnd)
-{
-  NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t" << newCwnd);
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << oldCwnd << "\t" << newCwnd << std::endl;
-}
 
 static void
 RxDrop (Ptr<PcapFileWrapper> file, Ptr<const Packet> p)
@@ -204,9 +78,11 @@ int
 main (int argc, char *argv[])
 {
   bool useV6 = false;
+  double cwndError = 1000;
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("useIpv6", "Use Ipv6", useV6);
+  cmd.AddValue ("cwndError", "Largest cwnd error (bytes) of the compressed seventh.cwnd trace", cwndError);
   cmd.Parse (argc, argv);
 
   NodeContainer nodes;
@@ -259,7 +135,8 @@ main (int argc, char *argv[])
 
   Ptr<Socket> ns3TcpSocket = Socket::CreateSocket (nodes.Get (0), TcpSocketFactory::GetTypeId ());
 
-  Ptr<MyApp> app = CreateObject<MyApp> ();
+  Ptr<ConstantRateGenerator> app = CreateObject<ConstantRateGenerator> ();
+  app->SetAttribute ("Backpressure", BooleanValue (true));
   app->Setup (ns3TcpSocket, sinkAddress, 1040, 1000, DataRate ("1Mbps"));
   nodes.Get (0)->AddApplication (app);
   app->SetStartTime (Seconds (1.));
@@ -267,7 +144,10 @@ main (int argc, char *argv[])
 
   AsciiTraceHelper asciiTraceHelper;
   Ptr<OutputStreamWrapper> stream = asciiTraceHelper.CreateFileStream ("seventh.cwnd");
-  ns3TcpSocket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndChange, stream));
+  // Only the change points of the window are written
+  Ptr<CwndCompressor> cwnd = Create<CwndCompressor> (stream->GetStream ());
+  cwnd->SetErrorBound (cwndError);
+  ns3TcpSocket->TraceConnectWithoutContext ("CongestionWindow", MakeCallback (&CwndCompressor::CwndChange, cwnd));
 
   PcapHelper pcapHelper;
   Ptr<PcapFileWrapper> file = pcapHelper.CreateFile ("seventh.pcap", std::ios::out, PcapHelper::DLT_PPP);
@@ -312,6 +192,11 @@ main (int argc, char *argv[])
 
   Simulator::Stop (Seconds (20));
   Simulator::Run ();
+  cwnd->Flush ();
+  NS_LOG_UNCOND ("Congestion window: " << cwnd->GetNUpdates () << " updates, "
+                 << cwnd->GetNPoints () << " change points written");
+  NS_LOG_UNCOND ("Application sent " << app->GetBytesSent () << " bytes, "
+                 << app->GetDeferredSends () << " sends deferred on a full socket buffer");
   Simulator::Destroy ();
 
   return 0;
@@ -24,6 +24,13 @@
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ssid.h"
 #include "ns3/flow-monitor-module.h"
+#include "traffic-generator.h"
+#include "throughput-sampler.h"
+#include "time-series-store.h"
+#include "compiled-config-path.h"
+#include "flow-stats-view.h"
+#include "flow-table-monitor.h"
+#include "hex-ring-position-allocator.h"
 
 // Default Network Topology
 //
@@ -40,134 +47,11 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("ThirdScriptExample");
 
-class MyApp : public Application
-{
-public:
-  MyApp ();
-  virtual ~MyApp ();
-
-  /**
-   * Register this type.
-   * \return The TypeId.
-   */
-  static TypeId GetTypeId (void);
-  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-
-private:
-  virtual void StartApplication (void);
-  virtual void StopApplication (void);
-
-  void ScheduleTx (void);
-  void SendPacket (void);
-
-  Ptr<Socket>     m_socket;
-  Address         m_peer;
-  uint32_t        m_packetSize;
-  uint32_t        m_nPackets;
-  DataRate        m_dataRate;
-  EventId         m_sendEvent;
-  bool            m_running;
-  uint32_t        m_packetsSent;
-};
-
-MyApp::MyApp ()
-  : m_socket (0),
-    m_peer (),
-    m_packetSize (0),
-    m_nPackets (0),
-    m_dataRate (0),
-    m_sendEvent (),
-    m_running (false),
-    m_packetsSent (0)
-{
-}
-
-MyApp::~MyApp ()
-{
-  m_socket = 0;
-}
-
-/* static */
-TypeId MyApp::GetTypeId (void)
-{
-  static TypeId tid = TypeId ("MyApp")
-    .SetParent<Application> ()
-    .SetGroupName ("Tutorial")
-    .AddConstructor<MyApp> ()
-    ;
-  return tid;
-}
-
-void
-MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void
-MyApp::StartApplication (void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  if (InetSocketAddress::IsMatchingType (m_peer))
-    {
-      m_socket->Bind ();
-    }
-  else
-    {
-      m_socket->Bind6 ();
-    }
-  m_socket->Connect (m_peer);
-  SendPacket ();
-}
-
-void
-MyApp::StopApplication (void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning ())
-    {
-      Simulator::Cancel (m_sendEvent);
-    }
-
-  if (m_socket)
-    {
-      m_socket->Close ();
-    }
-}
-
-void
-MyApp::SendPacket (void)
-{
-  Ptr<Packet> packet = Create<Packet> (m_packetSize);
-  m_socket->Send (packet);
-
-  if (++m_packetsSent < m_nPackets)
-    {
-      ScheduleTx ();
-    }
-}
-
-void
-MyApp::ScheduleTx (void)
-{
-  if (m_running)
-    {
-      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
-      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
-    }
-}
-
 static void
-CwndChange (Ptr<OutputStreamWrapper> stream, uint32_t oldCwnd, uint32_t newCwnd)
+CwndChange (Ptr<TimeSeriesStore> store, uint32_t series, uint32_t oldCwnd, uint32_t newCwnd)
 {
 //   NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t" << newCwnd);
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << oldCwnd << "\t" << newCwnd << std::endl;
+  store->Append (series, newCwnd);
 }
 
 // static void
@@ -180,38 +64,13 @@ CwndChange (Ptr<OutputStreamWrapper> stream, uint32_t oldCwnd, uint32_t newCwnd)
 uint64_t no_of_TCP_flows = 3;
 
 ApplicationContainer sink_all;                         /* Pointer to the packet sink application */
-uint64_t lastTotalRx[3] = {0,0,0};                     /* The value of the last total received bytes */
-
-AsciiTraceHelper graphascii;
-Ptr<OutputStreamWrapper> throughputstream[3];
-
-void
-CalculateThroughput ()
-{
-	uint32_t sink_no = sink_all.GetN();
-	for(uint32_t i = 0; i < sink_no; i++){
-		Ptr<PacketSink> sink = StaticCast<PacketSink> (sink_all.Get(i));
-		Time now = Simulator::Now ();                                         /* Return the simulator's virtual time. */
-		double cur = (sink->GetTotalRx () - lastTotalRx[i]) * (double) 8 / 1e5;     /* Convert Application RX Packets to MBits. */
-		*throughputstream[i]->GetStream() << Simulator::Now().GetSeconds() << "		" << cur << std::endl;
-		//std::cout << now.GetSeconds () << "s: \t" << cur << " Mbit/s" << std::endl;
-		lastTotalRx[i] = sink->GetTotalRx ();
-	}
-  
-  Simulator::Schedule (MilliSeconds (100), &CalculateThroughput);
-}
+ApplicationContainer source_all;                       /* The senders, for allocation counts */
 
 int 
 main (int argc, char *argv[])
 {
   Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpNewReno::GetTypeId()));
 
-  for(uint32_t i = 0; i < no_of_TCP_flows; i++){
-	  std::string temp = std::to_string(i);
-	  throughputstream[i] = graphascii.CreateFileStream("throughput_graph_plot_" + temp);
-  }
-
-
   bool verbose = true;
   uint32_t nWifi = 7;
   bool tracing = false;
@@ -225,15 +84,6 @@ main (int argc, char *argv[])
 
   cmd.Parse (argc,argv);
 
-  // The underlying restriction of 18 is due to the grid position
-  // allocator's configuration; the grid layout will exceed the
-  // bounding box if more than 18 nodes are provided.
-  if (nWifi > 18)
-    {
-      std::cout << "nWifi should be 18 or less; otherwise grid layout exceeds the bounding box" << std::endl;
-      return 1;
-    }
-
   if (verbose)
     {
       LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
@@ -312,31 +162,32 @@ main (int argc, char *argv[])
   em->SetAttribute ("ErrorRate", DoubleValue (.001));
 
   //after wifi netdevices are created
-  Config::Set("/NodeList/1/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
-  Config::Set("/NodeList/6/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
-  Config::Set("/NodeList/7/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
-  Config::Set("/NodeList/8/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
-  Config::Set("/NodeList/9/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel", PointerValue(em));
+  CompiledConfigPath errorModels ("/NodeList/[1,6-9]/DeviceList/0/$ns3::WifiNetDevice/Phy/$ns3::YansWifiPhy/PostReceptionErrorModel");
+  errorModels.Set (PointerValue (em));
 
 
   MobilityHelper mobility;
 
-  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
-                                 "MinX", DoubleValue (0.0),
-                                 "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (0.5),
-                                 "DeltaY", DoubleValue (1.0),
-                                 "GridWidth", UintegerValue (3),
-                                 "LayoutType", StringValue ("RowFirst"));
-
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
 
+  // Each BSS is a disc of hexagonal rings around its AP, the centre; the
+  // stations move closer together as nWifi grows, so the disc keeps its
+  // radius.
+  double bssRadius = 10.0;
+  double spacing = std::min (1.0, HexRingPositionAllocator::GetSpacing (nWifi + 1, bssRadius));
+  mobility.SetPositionAllocator ("ns3::HexRingPositionAllocator",
+                                 "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0),
+                                 "Spacing", DoubleValue (spacing));
+  mobility.Install (wifiApNode1);
   mobility.Install (wifiStaNodes1);
-  mobility.Install (wifiStaNodes2);
 
-  
-  mobility.Install (wifiApNode1);
+  mobility.SetPositionAllocator ("ns3::HexRingPositionAllocator",
+                                 "X", DoubleValue (2 * bssRadius + spacing),
+                                 "Y", DoubleValue (0.0),
+                                 "Spacing", DoubleValue (spacing));
   mobility.Install (wifiApNode2);
+  mobility.Install (wifiStaNodes2);
 
   InternetStackHelper stack;
   stack.Install (wifiApNode1);
@@ -349,11 +200,13 @@ main (int argc, char *argv[])
   address.SetBase ("10.1.1.0", "255.255.255.0");
   Ipv4InterfaceContainer p2pInterfaces = address.Assign (p2pDevices);
 
-  address.SetBase ("10.1.2.0", "255.255.255.0");
+  // A /24 holds 253 stations and the AP; a larger BSS gets a /16
+  bool wideBss = nWifi > 253;
+  address.SetBase (wideBss ? "10.2.0.0" : "10.1.2.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer staInterfaces1 = address.Assign (staDevices1);
   Ipv4InterfaceContainer apInterfaces1 = address.Assign (apDevices1);
 
-  address.SetBase ("10.1.3.0", "255.255.255.0");
+  address.SetBase (wideBss ? "10.3.0.0" : "10.1.3.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer staInterfaces2 = address.Assign (staDevices2);
   Ipv4InterfaceContainer apInterfaces2 = address.Assign (apDevices2);
 
@@ -361,6 +214,9 @@ main (int argc, char *argv[])
 
   uint16_t sinkPort = 8080;
 
+  // cwnd and throughput series, queried and exported once after the run
+  Ptr<TimeSeriesStore> metrics = CreateObject<TimeSeriesStore> ();
+
   // flow
   for(uint64_t i = 0; i < no_of_TCP_flows; i++) {
  
@@ -375,9 +231,10 @@ main (int argc, char *argv[])
 
     Ptr<Socket> ns3TcpSocket = Socket::CreateSocket (wifiStaNodes1.Get(i), TcpSocketFactory::GetTypeId ());
 
-    Ptr<MyApp> app = CreateObject<MyApp> ();
+    Ptr<ConstantRateGenerator> app = CreateObject<ConstantRateGenerator> ();
     app->Setup (ns3TcpSocket, sinkAddress, 1040, 1000, DataRate ("1Mbps"));
     wifiStaNodes1.Get(i)->AddApplication (app);
+    source_all.Add (app);
     app->SetStartTime (Seconds (1.));
     if(i == 0 || i == 2){
       app->SetStopTime (Seconds (simulationTime));
@@ -385,7 +242,6 @@ main (int argc, char *argv[])
     else
       app->SetStopTime (Seconds (simulationTime));
     
-    Simulator::Schedule (Seconds (1.1), &CalculateThroughput);
     if(i == 0 || i == 2){
       Simulator::Stop (Seconds (simulationTime));
     }
@@ -394,34 +250,72 @@ main (int argc, char *argv[])
     
     //-------- trace ------ //
 
-    AsciiTraceHelper asciiTraceHelper;
-    Ptr<OutputStreamWrapper> stream = asciiTraceHelper.CreateFileStream ("customnet_" + std::to_string(i) + ".cwnd");
-    ns3TcpSocket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndChange, stream));
+    uint32_t cwndSeries = metrics->AddSeries ("cwnd" + std::to_string(i));
+    ns3TcpSocket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndChange, metrics, cwndSeries));
 
   }
 
-  FlowMonitorHelper flowmon;
-  Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+  // The Mbit/s of every flow each 100 ms, as series throughput0, 1, ...
+  Ptr<ThroughputSampler> sampler = CreateObject<ThroughputSampler> ();
+  sampler->Add (sink_all);
+  sampler->Start (metrics, Seconds (1.1), MilliSeconds (100));
+
+  // One monitor for the flow statistics, the delay percentiles and the
+  // snapshots
+  Ptr<FlowTableMonitor> flows = CreateObject<FlowTableMonitor> ();
+  flows->SetAttribute ("LatencyHistograms", BooleanValue (true));
+  flows->InstallAll ();
+
+  // What changed in every flow each second, for looking into long runs
+  Ptr<FlowStatsSnapshot> snapshots = CreateObject<FlowStatsSnapshot> ();
+  snapshots->Start (flows, "taska1.snap", Seconds (1), Seconds (1));
     Simulator::Run ();
-    //double averageThroughput = ((sink->GetTotalRx () * 8) / (1e6 * simulationTime));
+    sampler->Stop ();
+    snapshots->Stop ();
 
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier() );
-  FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
+  for (uint32_t i = 0; i < no_of_TCP_flows; i++)
+    {
+      uint32_t throughput = metrics->GetSeries ("throughput" + std::to_string (i));
+      uint32_t cwnd = metrics->GetSeries ("cwnd" + std::to_string (i));
+      NS_LOG_UNCOND ("Flow " << i << ": mean throughput = "
+                     << metrics->Aggregate (throughput, Seconds (2), Seconds (simulationTime), TimeSeriesStore::MEAN)
+                     << " Mbit/s, peak cwnd = "
+                     << metrics->Aggregate (cwnd, Seconds (0), Seconds (simulationTime), TimeSeriesStore::MAX));
+    }
+  metrics->Export ("taska1.tsdb");
+    //double averageThroughput = ((sink->GetTotalRx () * 8) / (1e6 * simulationTime));
 
+  uint64_t payloadAllocations = 0;
+  uint64_t packetsCreated = 0;
+  for (uint32_t i = 0; i < source_all.GetN (); i++)
+    {
+      Ptr<ConstantRateGenerator> source = StaticCast<ConstantRateGenerator> (source_all.Get (i));
+      payloadAllocations += source->GetPayloadAllocations ();
+      packetsCreated += source->GetPacketsCreated ();
+    }
+  // Each packet is still a new Packet object; only the payload buffer is shared
+  NS_LOG_UNCOND ("Packets created = " << packetsCreated << ", payload buffers allocated = " << payloadAllocations
+                 << ", buffer allocations saved = " << packetsCreated - payloadAllocations);
 
-  for(auto iter = stats.begin(); iter != stats.end(); ++iter){
-	  Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
-	  NS_LOG_UNCOND("__Flow ID: " << iter->first);
+  LatencyHistogram allDelays;
+  flows->ForEach ([&] (FlowId id, const FlowTableMonitor::FiveTuple &t, const FlowTableMonitor::FlowStats &s) {
+	  NS_LOG_UNCOND("__Flow ID: " << id);
 	  NS_LOG_UNCOND("src addr: " << t.sourceAddress << "-- dest addr: " << t.destinationAddress);
-	  NS_LOG_UNCOND("Sent Packets=" <<iter->second. txPackets);
-	  NS_LOG_UNCOND ("Received Patkets =" <<iter->second. rxPackets);
-    NS_LOG_UNCOND ("Lost Packets=" <<iter->second. txPackets-iter->second. rxPackets);
-    NS_LOG_UNCOND("Packet delivery ratio = " <<iter->second.rxPackets*100.0/iter->second.txPackets << "%");
-	  NS_LOG_UNCOND ("Packet loss ratio =" << (iter->second.txPackets-iter->second.rxPackets)*100.0/iter->second. txPackets << "%");
-    NS_LOG_UNCOND ("Delay =" <<iter->second.delaySum);
-    NS_LOG_UNCOND ("Jitter =" <<iter->second. jitterSum);
-    NS_LOG_UNCOND ("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds()));
-  }
+	  NS_LOG_UNCOND("Sent Packets=" <<s.txPackets);
+	  NS_LOG_UNCOND ("Received Patkets =" <<s.rxPackets);
+    NS_LOG_UNCOND ("Lost Packets=" <<s.txPackets-s.rxPackets);
+    NS_LOG_UNCOND("Packet delivery ratio = " <<s.rxPackets*100.0/s.txPackets << "%");
+	  NS_LOG_UNCOND ("Packet loss ratio =" << (s.txPackets-s.rxPackets)*100.0/s.txPackets << "%");
+    NS_LOG_UNCOND ("Delay =" <<s.delaySum);
+    NS_LOG_UNCOND ("Jitter =" <<s.jitterSum);
+    const LatencyHistogram &delays = flows->GetLatencyHistogram (id);
+    NS_LOG_UNCOND ("Delay p50/p99/p99.9 =" << delays.GetPercentile (50).As (Time::MS) << " / "
+                   << delays.GetPercentile (99).As (Time::MS) << " / " << delays.GetPercentile (99.9).As (Time::MS));
+    allDelays.Merge (delays);
+    NS_LOG_UNCOND ("Throughput =" <<s.rxBytes * 8.0/(s.timeLastRxPacket.GetSeconds()-s.timeFirstTxPacket.GetSeconds()));
+  });
+  NS_LOG_UNCOND ("All flows delay p50/p99/p99.9 = " << allDelays.GetPercentile (50).As (Time::MS) << " / "
+                 << allDelays.GetPercentile (99).As (Time::MS) << " / " << allDelays.GetPercentile (99.9).As (Time::MS));
 
   Simulator::Destroy ();
   //std::cout << "\nAverage throughput: " << averageThroughput << " Mbit/s" << std::endl;
@@ -53,6 +53,8 @@
 // This transmission and reception (ack) trace is the most direct way to
 // observe the effects of pacing.  All the above information is traced
 // just for the single node n0.
+// The tracers record into a binary trace, tcp-dynamic-pacing.trbin, which
+// './waf --run trace-convert' turns into the data files above.
 //
 // A small amount of randomness is introduced to the program to control
 // the start time of the flows.
@@ -92,54 +94,66 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#include "traffic-generator.h"
+#include "dumbbell-builder.h"
+#include "trace-writer.h"
+#include "traced-tcp-socket-factory.h"
+#include "flow-report.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("TcpPacingExample");
 
-std::ofstream cwndStream;
-std::ofstream pacingRateStream;
-std::ofstream ssThreshStream;
-std::ofstream packetTraceStream;
+// All tracers append binary records; run trace-convert on
+// tcp-dynamic-pacing.trbin to get the usual .dat files.
+TraceWriter traceWriter;
+uint32_t cwndChannel;
+uint32_t pacingRateChannel;
+uint32_t ssThreshChannel;
+uint32_t txChannel;
+uint32_t rxChannel;
 
 static void
 CwndTracer (uint32_t oldval, uint32_t newval)
 {
-  cwndStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  traceWriter.Write (cwndChannel, newval);
 }
 
 static void
 PacingRateTracer (DataRate oldval, DataRate newval)
 {
-  pacingRateStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval.GetBitRate () / 1e6 << std::endl;
+  traceWriter.Write (pacingRateChannel, newval.GetBitRate () / 1e6);
 }
 
 static void
 SsThreshTracer (uint32_t oldval, uint32_t newval)
 {
-  ssThreshStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  traceWriter.Write (ssThreshChannel, newval);
 }
 
 static void
 TxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " tx " << p->GetSize () << std::endl;
+  traceWriter.Write (txChannel, p->GetSize ());
 }
 
 static void
 RxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " rx " << p->GetSize () << std::endl;
+  traceWriter.Write (rxChannel, p->GetSize ());
 }
 
 void
-ConnectSocketTraces (void)
+ConnectTraces (Ptr<Node> node)
 {
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow", MakeCallback (&CwndTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/PacingRate", MakeCallback (&PacingRateTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/SlowStartThreshold", MakeCallback (&SsThreshTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::Ipv4L3Protocol/Tx", MakeCallback (&TxTracer));
-  Config::ConnectWithoutContext ("/NodeList/0/$ns3::Ipv4L3Protocol/Rx", MakeCallback (&RxTracer));
+  // Socket traces attach when n0 creates its socket; no Config paths
+  Ptr<TracedTcpSocketFactory> factory = TracedTcpSocketFactory::Install (node);
+  factory->SetCwndCallback (MakeCallback (&CwndTracer));
+  factory->SetPacingRateCallback (MakeCallback (&PacingRateTracer));
+  factory->SetSsThreshCallback (MakeCallback (&SsThreshTracer));
+  Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+  ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&TxTracer));
+  ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&RxTracer));
 }
 
 int
@@ -184,63 +198,35 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::TcpSocketBase::UseEcn", (useEcn ? EnumValue (TcpSocketState::On) : EnumValue (TcpSocketState::Off)));
   Config::SetDefault ("ns3::TcpSocketState::MaxPacingRate", DataRateValue (maxPacingRate));
 
-  NS_LOG_INFO ("Create nodes.");
-  NodeContainer c;
-  c.Create (6);
-
-  NS_LOG_INFO ("Create channels.");
-  NodeContainer n0n2 = NodeContainer (c.Get (0), c.Get (2));
-  NodeContainer n1n2 = NodeContainer (c.Get (1), c.Get (2));
-
-  NodeContainer n2n3 = NodeContainer (c.Get (2), c.Get (3));
-
-  NodeContainer n3n4 = NodeContainer (c.Get (3), c.Get (4));
-  NodeContainer n3n5 = NodeContainer (c.Get (3), c.Get (5));
-
+  NS_LOG_INFO ("Create nodes and channels.");
   //Define Node link properties
   PointToPointHelper regLink;
   regLink.SetDeviceAttribute ("DataRate", DataRateValue (regLinkBandwidth));
   regLink.SetChannelAttribute ("Delay", TimeValue (regLinkDelay));
 
-  NetDeviceContainer d0d2 = regLink.Install (n0n2);
-  NetDeviceContainer d1d2 = regLink.Install (n1n2);
-  NetDeviceContainer d3d4 = regLink.Install (n3n4);
-  NetDeviceContainer d3d5 = regLink.Install (n3n5);
-
   PointToPointHelper bottleNeckLink;
   bottleNeckLink.SetDeviceAttribute ("DataRate", DataRateValue (bottleneckBandwidth));
   bottleNeckLink.SetChannelAttribute ("Delay", TimeValue (bottleneckDelay));
 
-  NetDeviceContainer d2d3 = bottleNeckLink.Install (n2n3);
+  // Two senders n0, n1 behind router n2 and two sinks n4, n5 behind n3
+  DumbbellBuilder dumbbell (regLink, bottleNeckLink);
+  dumbbell.Build (2, 2);
 
   //Install Internet stack
   InternetStackHelper stack;
-  stack.Install (c);
+  dumbbell.InstallStack (stack);
 
   // Install traffic control
   if (useQueueDisc)
     {
       TrafficControlHelper tchBottleneck;
       tchBottleneck.SetRootQueueDisc ("ns3::FqCoDelQueueDisc");
-      tchBottleneck.Install (d2d3);
+      tchBottleneck.Install (dumbbell.GetBottleneckDevices ());
     }
 
   NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface0 = ipv4.Assign (d0d2);
-
-  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface1 = ipv4.Assign (d1d2);
-
-  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer bottleneckInterface = ipv4.Assign (d2d3);
-
-  ipv4.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface4 = ipv4.Assign (d3d4);
-
-  ipv4.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface5 = ipv4.Assign (d3d5);
+  // 10.1.1.0/24 to 10.1.5.0/24: n0-n2, n1-n2, n2-n3, n3-n4, n3-n5
+  dumbbell.AssignIpv4Addresses ("10.1.1.0", "255.255.255.0");
 
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
@@ -248,11 +234,11 @@ main (int argc, char *argv[])
 
   // Two Sink Applications at n4 and n5
   uint16_t sinkPort = 8080;
-  Address sinkAddress4 (InetSocketAddress (regLinkInterface4.GetAddress (1), sinkPort)); // interface of n4
-  Address sinkAddress5 (InetSocketAddress (regLinkInterface5.GetAddress (1), sinkPort)); // interface of n5
+  Address sinkAddress4 (InetSocketAddress (dumbbell.GetRightIpv4Address (0), sinkPort)); // interface of n4
+  Address sinkAddress5 (InetSocketAddress (dumbbell.GetRightIpv4Address (1), sinkPort)); // interface of n5
   PacketSinkHelper packetSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
-  ApplicationContainer sinkApps4 = packetSinkHelper.Install (c.Get (4)); //n4 as sink
-  ApplicationContainer sinkApps5 = packetSinkHelper.Install (c.Get (5)); //n5 as sink
+  ApplicationContainer sinkApps4 = packetSinkHelper.Install (dumbbell.GetRight (0)); //n4 as sink
+  ApplicationContainer sinkApps5 = packetSinkHelper.Install (dumbbell.GetRight (1)); //n5 as sink
 
   sinkApps4.Start (Seconds (0));
   sinkApps4.Stop (simulationEndTime);
@@ -263,19 +249,26 @@ main (int argc, char *argv[])
   Ptr<UniformRandomVariable> uniformRv = CreateObject<UniformRandomVariable> ();
   uniformRv->SetStream (0);
 
-  // Two Source Applications at n0 and n1
-  BulkSendHelper source0 ("ns3::TcpSocketFactory", sinkAddress4);
-  BulkSendHelper source1 ("ns3::TcpSocketFactory", sinkAddress5);
-  // Set the amount of data to send in bytes.  Zero is unlimited.
-  source0.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
-  source1.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
-  ApplicationContainer sourceApps0 = source0.Install (c.Get (0));
-  ApplicationContainer sourceApps1 = source1.Install (c.Get (1));
-
-  sourceApps0.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
-  sourceApps0.Stop (simulationEndTime);
-  sourceApps1.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
-  sourceApps1.Stop (simulationEndTime);
+  // Two Source Applications at n0 and n1.  The bulk senders write only
+  // what the socket send buffer can take, refilling it from the socket's
+  // send callback, and stop after exactly maxBytes; zero is unlimited.
+  uint32_t sendSize = 512;
+  ConnectTraces (dumbbell.GetLeft (0));
+  Ptr<Socket> sourceSocket0 = Socket::CreateSocket (dumbbell.GetLeft (0), TracedTcpSocketFactory::GetTypeId ());
+  Ptr<Socket> sourceSocket1 = Socket::CreateSocket (dumbbell.GetLeft (1), TcpSocketFactory::GetTypeId ());
+  Ptr<BulkGenerator> source0 = CreateObject<BulkGenerator> ();
+  Ptr<BulkGenerator> source1 = CreateObject<BulkGenerator> ();
+  source0->Setup (sourceSocket0, sinkAddress4, sendSize, 0, DataRate (0));
+  source1->Setup (sourceSocket1, sinkAddress5, sendSize, 0, DataRate (0));
+  source0->SetAttribute ("MaxBytes", UintegerValue (maxBytes));
+  source1->SetAttribute ("MaxBytes", UintegerValue (maxBytes));
+  dumbbell.GetLeft (0)->AddApplication (source0);
+  dumbbell.GetLeft (1)->AddApplication (source1);
+
+  source0->SetStartTime (MicroSeconds (uniformRv->GetInteger (0, 1000)));
+  source0->SetStopTime (simulationEndTime);
+  source1->SetStartTime (MicroSeconds (uniformRv->GetInteger (0, 1000)));
+  source1->SetStopTime (simulationEndTime);
 
   if (tracing)
     {
@@ -284,19 +277,12 @@ main (int argc, char *argv[])
       regLink.EnablePcapAll ("tcp-dynamic-pacing", false);
     }
 
-  cwndStream.open ("tcp-dynamic-pacing-cwnd.dat", std::ios::out);
-  //cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
-
-  pacingRateStream.open ("tcp-dynamic-pacing-pacing-rate.dat", std::ios::out);
-  pacingRateStream << "#Time(s) Pacing Rate (Mb/s)" << std::endl;
-
-  ssThreshStream.open ("tcp-dynamic-pacing-ssthresh.dat", std::ios::out);
-  ssThreshStream << "#Time(s) Slow Start threshold (B)" << std::endl;
-
-  packetTraceStream.open ("tcp-dynamic-pacing-packet-trace.dat", std::ios::out);
-  packetTraceStream << "#Time(s) tx/rx size (B)" << std::endl;
-
-  Simulator::Schedule (MicroSeconds (1001), &ConnectSocketTraces);
+  cwndChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-cwnd.dat");
+  pacingRateChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-pacing-rate.dat", "", "#Time(s) Pacing Rate (Mb/s)");
+  ssThreshChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-ssthresh.dat", "", "#Time(s) Slow Start threshold (B)");
+  txChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-packet-trace.dat", "tx", "#Time(s) tx/rx size (B)");
+  rxChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-packet-trace.dat", "rx");
+  traceWriter.Open ("tcp-dynamic-pacing.trbin");
 
   FlowMonitorHelper flowmon;
   Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
@@ -305,37 +291,23 @@ main (int argc, char *argv[])
   Simulator::Stop (simulationEndTime);
   Simulator::Run ();
 
-  int j = 0;
-  float AvgThroughput = 0;
-
   monitor->CheckForLostPackets ();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
-  FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i)
-    {
-      Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-
-      std::cout << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-      std::cout << "  Tx Packets: " << i->second.txPackets << "\n";
-      std::cout << "  Tx Bytes:   " << i->second.txBytes << "\n";
-      std::cout << "  TxOffered:  " << i->second.txBytes * 8.0 / simulationEndTime.GetSeconds () / 1000 / 1000  << " Mbps\n";
-      std::cout << "  Rx Packets: " << i->second.rxPackets << "\n";
-      std::cout << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-      std::cout << "  Throughput: " << i->second.rxBytes * 8.0 / simulationEndTime.GetSeconds () / 1000 / 1000  << " Mbps\n";
-      AvgThroughput = AvgThroughput + i->second.rxBytes * 8.0 / simulationEndTime.GetSeconds () / 1000 / 1000 ;
-      j = j +1;
-
-    }
+  FlowReport report;
+  report.SetDuration (simulationEndTime);
+  report.AddAll (monitor, classifier);
+  report.GroupBy ([sinkPort] (const FlowReport::FiveTuple &t) { return t.destinationPort == sinkPort ? "data" : "ack"; });
+  report.Compute ();
+  report.Print (std::cout);
+  report.WriteCsv ("tcp-pacing-flows.csv");
 
-    AvgThroughput = AvgThroughput / j;
-     std::cout << " Average Throughput: " <<  AvgThroughput << "Mbps\n";
+  std::cout << " Application Tx n0: " << source0->GetBytesSent () * 8.0 / simulationEndTime.GetSeconds () / 1000 / 1000 << " Mbps\n";
+  std::cout << " Application Tx n1: " << source1->GetBytesSent () * 8.0 / simulationEndTime.GetSeconds () / 1000 / 1000 << " Mbps\n";
 
 
 
 
 
-  cwndStream.close ();
-  pacingRateStream.close ();
-  ssThreshStream.close ();
+  traceWriter.Close ();
   Simulator::Destroy ();
 }
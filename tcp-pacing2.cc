@@ -43,7 +43,8 @@
 // At the end of the simulation, the IP-level flow monitor tool will
 // print out summary statistics of the flows.  The flow monitor detects
 // four flows, but that is because the flow records are unidirectional;
-// the latter two flows reported are actually ack streams.
+// the latter two flows reported are actually ack streams.  The nFlows
+// option widens the dumbbell to that many senders and sinks.
 //
 // At the end of this simulation, data files are also generated
 // that track changes in Congestion Window, Slow Start threshold and
@@ -53,6 +54,8 @@
 // This transmission and reception (ack) trace is the most direct way to
 // observe the effects of pacing.  All the above information is traced
 // just for the single node n0.
+// The tracers record into a binary trace, tcp-dynamic-pacing.trbin, which
+// './waf --run trace-convert' turns into the data files above.
 //
 // A small amount of randomness is introduced to the program to control
 // the start time of the flows.
@@ -92,44 +95,50 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
+#include "trace-writer.h"
+#include "dumbbell-builder.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("TcpPacingExample");
 
-std::ofstream cwndStream;
-std::ofstream pacingRateStream;
-std::ofstream ssThreshStream;
-std::ofstream packetTraceStream;
+// All tracers append binary records; run trace-convert on
+// tcp-dynamic-pacing.trbin to get the usual .dat files.
+TraceWriter traceWriter;
+uint32_t cwndChannel;
+uint32_t pacingRateChannel;
+uint32_t ssThreshChannel;
+uint32_t txChannel;
+uint32_t rxChannel;
 
 static void
 CwndTracer (uint32_t oldval, uint32_t newval)
 {
-  cwndStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  traceWriter.Write (cwndChannel, newval);
 }
 
 static void
 PacingRateTracer (DataRate oldval, DataRate newval)
 {
-  pacingRateStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval.GetBitRate () / 1e6 << std::endl;
+  traceWriter.Write (pacingRateChannel, newval.GetBitRate () / 1e6);
 }
 
 static void
 SsThreshTracer (uint32_t oldval, uint32_t newval)
 {
-  ssThreshStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << std::setw (12) << newval << std::endl;
+  traceWriter.Write (ssThreshChannel, newval);
 }
 
 static void
 TxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " tx " << p->GetSize () << std::endl;
+  traceWriter.Write (txChannel, p->GetSize ());
 }
 
 static void
 RxTracer (Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
 {
-  packetTraceStream << std::fixed << std::setprecision (6) << Simulator::Now ().GetSeconds () << " rx " << p->GetSize () << std::endl;
+  traceWriter.Write (rxChannel, p->GetSize ());
 }
 
 void
@@ -161,6 +170,7 @@ main (int argc, char *argv[])
   bool useEcn = true;
   bool useQueueDisc = true;
   bool shouldPaceInitialWindow = true;
+  uint32_t nFlows = 2;
 
   // Configure defaults that are not based on explicit command-line arguments
   // They may be overridden by general attribute configuration of command line
@@ -176,6 +186,7 @@ main (int argc, char *argv[])
   cmd.AddValue ("useQueueDisc", "Flag to enable/disable queue disc on bottleneck", useQueueDisc);
   cmd.AddValue ("shouldPaceInitialWindow", "Flag to enable/disable pacing of TCP initial window", shouldPaceInitialWindow);
   cmd.AddValue ("simulationEndTime", "Simulation end time", simulationEndTime);
+  cmd.AddValue ("nFlows", "Number of sender/sink pairs across the bottleneck", nFlows);
   cmd.Parse (argc, argv);
 
   // Configure defaults based on command-line arguments
@@ -184,98 +195,65 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::TcpSocketBase::UseEcn", (useEcn ? EnumValue (TcpSocketState::On) : EnumValue (TcpSocketState::Off)));
   Config::SetDefault ("ns3::TcpSocketState::MaxPacingRate", DataRateValue (maxPacingRate));
 
-  NS_LOG_INFO ("Create nodes.");
-  NodeContainer c;
-  c.Create (6);
-
-  NS_LOG_INFO ("Create channels.");
-  NodeContainer n0n2 = NodeContainer (c.Get (0), c.Get (2));
-  NodeContainer n1n2 = NodeContainer (c.Get (1), c.Get (2));
-
-  NodeContainer n2n3 = NodeContainer (c.Get (2), c.Get (3));
-
-  NodeContainer n3n4 = NodeContainer (c.Get (3), c.Get (4));
-  NodeContainer n3n5 = NodeContainer (c.Get (3), c.Get (5));
-
+  NS_LOG_INFO ("Create nodes and channels.");
   //Define Node link properties
   PointToPointHelper regLink;
   regLink.SetDeviceAttribute ("DataRate", DataRateValue (regLinkBandwidth));
   regLink.SetChannelAttribute ("Delay", TimeValue (regLinkDelay));
 
-  NetDeviceContainer d0d2 = regLink.Install (n0n2);
-  NetDeviceContainer d1d2 = regLink.Install (n1n2);
-  NetDeviceContainer d3d4 = regLink.Install (n3n4);
-  NetDeviceContainer d3d5 = regLink.Install (n3n5);
-
   PointToPointHelper bottleNeckLink;
   bottleNeckLink.SetDeviceAttribute ("DataRate", DataRateValue (bottleneckBandwidth));
   bottleNeckLink.SetChannelAttribute ("Delay", TimeValue (bottleneckDelay));
 
-  NetDeviceContainer d2d3 = bottleNeckLink.Install (n2n3);
+  // nFlows senders behind the left router and as many sinks behind the
+  // right one; for two flows, n0 and n1 behind n2 and n4 and n5 behind n3
+  DumbbellBuilder dumbbell (regLink, bottleNeckLink);
+  dumbbell.Build (nFlows, nFlows);
 
   //Install Internet stack
   InternetStackHelper stack;
-  stack.Install (c);
+  dumbbell.InstallStack (stack);
 
   // Install traffic control
   if (useQueueDisc)
     {
       TrafficControlHelper tchBottleneck;
       tchBottleneck.SetRootQueueDisc ("ns3::FqCoDelQueueDisc");
-      tchBottleneck.Install (d2d3);
+      tchBottleneck.Install (dumbbell.GetBottleneckDevices ());
     }
 
   NS_LOG_INFO ("Assign IP Addresses.");
-  Ipv4AddressHelper ipv4;
-  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface0 = ipv4.Assign (d0d2);
-
-  ipv4.SetBase ("10.1.2.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface1 = ipv4.Assign (d1d2);
-
-  ipv4.SetBase ("10.1.3.0", "255.255.255.0");
-  Ipv4InterfaceContainer bottleneckInterface = ipv4.Assign (d2d3);
-
-  ipv4.SetBase ("10.1.4.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface4 = ipv4.Assign (d3d4);
-
-  ipv4.SetBase ("10.1.5.0", "255.255.255.0");
-  Ipv4InterfaceContainer regLinkInterface5 = ipv4.Assign (d3d5);
+  // One /24 per link from 10.1.1.0: n0-n2, n1-n2, n2-n3, n3-n4, n3-n5 for
+  // two flows
+  dumbbell.AssignIpv4Addresses ("10.1.1.0", "255.255.255.0");
 
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
   NS_LOG_INFO ("Create Applications.");
 
-  // Two Sink Applications at n4 and n5
+  // A sink on every right leaf and a bulk sender to it on the left leaf of
+  // the same index; with the default of two flows n0 -> n4 and n1 -> n5
   uint16_t sinkPort = 8080;
-  Address sinkAddress4 (InetSocketAddress (regLinkInterface4.GetAddress (1), sinkPort)); // interface of n4
-  Address sinkAddress5 (InetSocketAddress (regLinkInterface5.GetAddress (1), sinkPort)); // interface of n5
   PacketSinkHelper packetSinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), sinkPort));
-  ApplicationContainer sinkApps4 = packetSinkHelper.Install (c.Get (4)); //n4 as sink
-  ApplicationContainer sinkApps5 = packetSinkHelper.Install (c.Get (5)); //n5 as sink
-
-  sinkApps4.Start (Seconds (0));
-  sinkApps4.Stop (simulationEndTime);
-  sinkApps5.Start (Seconds (0));
-  sinkApps5.Stop (simulationEndTime);
+  BulkSendHelper source ("ns3::TcpSocketFactory", Address ());
+  // Set the amount of data to send in bytes.  Zero is unlimited.
+  source.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
 
   // Randomize the start time between 0 and 1ms
   Ptr<UniformRandomVariable> uniformRv = CreateObject<UniformRandomVariable> ();
   uniformRv->SetStream (0);
 
-  // Two Source Applications at n0 and n1
-  BulkSendHelper source0 ("ns3::TcpSocketFactory", sinkAddress4);
-  BulkSendHelper source1 ("ns3::TcpSocketFactory", sinkAddress5);
-  // Set the amount of data to send in bytes.  Zero is unlimited.
-  source0.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
-  source1.SetAttribute ("MaxBytes", UintegerValue (maxBytes));
-  ApplicationContainer sourceApps0 = source0.Install (c.Get (0));
-  ApplicationContainer sourceApps1 = source1.Install (c.Get (1));
-
-  sourceApps0.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
-  sourceApps0.Stop (simulationEndTime);
-  sourceApps1.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
-  sourceApps1.Stop (simulationEndTime);
+  ApplicationContainer sinkApps;
+  for (uint32_t i = 0; i < nFlows; ++i)
+    {
+      sinkApps.Add (packetSinkHelper.Install (dumbbell.GetRight (i)));
+      source.SetAttribute ("Remote", AddressValue (InetSocketAddress (dumbbell.GetRightIpv4Address (i), sinkPort)));
+      ApplicationContainer sourceApp = source.Install (dumbbell.GetLeft (i));
+      sourceApp.Start (MicroSeconds (uniformRv->GetInteger (0, 1000)));
+      sourceApp.Stop (simulationEndTime);
+    }
+  sinkApps.Start (Seconds (0));
+  sinkApps.Stop (simulationEndTime);
 
   if (tracing)
     {
@@ -284,17 +262,12 @@ main (int argc, char *argv[])
       regLink.EnablePcapAll ("tcp-dynamic-pacing", false);
     }
 
-  cwndStream.open ("tcp-dynamic-pacing-cwnd.dat", std::ios::out);
-  //cwndStream << "#Time(s) Congestion Window (B)" << std::endl;
-
-  pacingRateStream.open ("tcp-dynamic-pacing-pacing-rate.dat", std::ios::out);
-  pacingRateStream << "#Time(s) Pacing Rate (Mb/s)" << std::endl;
-
-  ssThreshStream.open ("tcp-dynamic-pacing-ssthresh.dat", std::ios::out);
-  ssThreshStream << "#Time(s) Slow Start threshold (B)" << std::endl;
-
-  packetTraceStream.open ("tcp-dynamic-pacing-packet-trace.dat", std::ios::out);
-  packetTraceStream << "#Time(s) tx/rx size (B)" << std::endl;
+  cwndChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-cwnd.dat");
+  pacingRateChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-pacing-rate.dat", "", "#Time(s) Pacing Rate (Mb/s)");
+  ssThreshChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-ssthresh.dat", "", "#Time(s) Slow Start threshold (B)");
+  txChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-packet-trace.dat", "tx", "#Time(s) tx/rx size (B)");
+  rxChannel = traceWriter.AddChannel ("tcp-dynamic-pacing-packet-trace.dat", "rx");
+  traceWriter.Open ("tcp-dynamic-pacing.trbin");
 
   Simulator::Schedule (MicroSeconds (1001), &ConnectSocketTraces);
 
@@ -310,7 +283,7 @@ main (int argc, char *argv[])
 
   monitor->CheckForLostPackets ();
   Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
-  FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i)
     {
       Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
@@ -334,9 +307,7 @@ main (int argc, char *argv[])
 
 
 
-  cwndStream.close ();
-  pacingRateStream.close ();
-  ssThreshStream.close ();
+  traceWriter.Close ();
   Simulator::Destroy ();
 }
 
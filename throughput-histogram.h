@@ -0,0 +1,297 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef THROUGHPUT_HISTOGRAM_H
+#define THROUGHPUT_HISTOGRAM_H
+
+#include <cstdio>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+
+// ===========================================================================
+//
+// Event-driven receive accounting for PacketSinks.  Instead of waking up
+// every few hundred milliseconds to diff GetTotalRx, the histogram hooks the
+// "Rx" trace of each sink and adds the packet size to a fixed-width time
+// bucket.  Buckets are created only when traffic arrives, so idle periods
+// cost nothing, and no periodic events are scheduled at all.  After the run
+// the throughput series can be read at any multiple of the bucket width:
+//
+//   Ptr<ThroughputHistogram> histogram = CreateObject<ThroughputHistogram> ();
+//   histogram->Add (sinkApps);
+//   Simulator::Run ();
+//   histogram->Print (std::cout, MilliSeconds (500), Seconds (1), Seconds (10));
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Bins the bytes received by a set of PacketSinks over time.
+ */
+class ThroughputHistogram : public Object
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  ThroughputHistogram ();
+  virtual ~ThroughputHistogram ();
+
+  /**
+   * Start accounting the traffic of \p sink.  BucketWidth must be set
+   * before the first sink is added.
+   * \param sink the sink to account
+   * \return the index of the flow
+   */
+  uint32_t Add (Ptr<PacketSink> sink);
+  /**
+   * \param sinks PacketSink applications to account, in flow order
+   */
+  void Add (ApplicationContainer sinks);
+  /**
+   * \return the number of accounted flows
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \param flow the flow index
+   * \return the bytes received by the flow so far
+   */
+  uint64_t GetTotalBytes (uint32_t flow) const;
+  /**
+   * \param flow the flow index
+   * \return the number of buckets allocated for the flow
+   */
+  uint32_t GetNBuckets (uint32_t flow) const;
+
+  /**
+   * The throughput of \p flow in bit/s, one value per \p resolution from
+   * \p start to \p stop.  \p resolution and \p start must be multiples of
+   * the bucket width.
+   * \param flow the flow index
+   * \param resolution the width of each value
+   * \param start the start of the first value
+   * \param stop the end of the series
+   * \return the series
+   */
+  std::vector<double> GetThroughput (uint32_t flow, Time resolution, Time start, Time stop) const;
+
+  /**
+   * Print one row per \p resolution with the end time of the interval and
+   * the throughput of every flow, in bit/s divided by \p unit.
+   * \param os the output stream
+   * \param resolution the width of each interval
+   * \param start the start of the first interval
+   * \param stop the end of the series
+   * \param unit the throughput unit in bit/s
+   */
+  void Print (std::ostream &os, Time resolution, Time start, Time stop, double unit = 1e6) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// A bucket with traffic: its index since time zero and its byte count.
+  struct Bucket
+  {
+    int64_t index;  //!< the bucket covers [index, index + 1) bucket widths
+    uint64_t bytes; //!< bytes received in the bucket
+  };
+
+  /// An accounted sink and its buckets, in time order.
+  struct Flow
+  {
+    Ptr<PacketSink> sink;         //!< the accounted sink
+    int64_t width;                //!< bucket width in time steps
+    uint64_t totalBytes;          //!< bytes received so far
+    std::vector<Bucket> buckets;  //!< buckets with traffic, oldest first
+  };
+
+  static void NotifyRx (Flow *flow, Ptr<const Packet> packet, const Address &from);
+
+  Time              m_width;
+  std::deque<Flow>  m_flows; //!< a deque, so the bound Flow pointers stay valid
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ThroughputHistogram);
+
+inline TypeId
+ThroughputHistogram::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ThroughputHistogram")
+    .SetParent<Object> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<ThroughputHistogram> ()
+    .AddAttribute ("BucketWidth",
+                   "The time covered by one bucket.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&ThroughputHistogram::m_width),
+                   MakeTimeChecker (TimeStep (1)))
+    ;
+  return tid;
+}
+
+inline
+ThroughputHistogram::ThroughputHistogram ()
+{
+}
+
+inline
+ThroughputHistogram::~ThroughputHistogram ()
+{
+}
+
+inline void
+ThroughputHistogram::DoDispose (void)
+{
+  for (std::deque<Flow>::iterator it = m_flows.begin (); it != m_flows.end (); ++it)
+    {
+      it->sink->TraceDisconnectWithoutContext ("Rx", MakeBoundCallback (&ThroughputHistogram::NotifyRx, &*it));
+    }
+  m_flows.clear ();
+  Object::DoDispose ();
+}
+
+inline uint32_t
+ThroughputHistogram::Add (Ptr<PacketSink> sink)
+{
+  m_flows.push_back (Flow ());
+  Flow &flow = m_flows.back ();
+  flow.sink = sink;
+  flow.width = m_width.GetTimeStep ();
+  flow.totalBytes = 0;
+  sink->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&ThroughputHistogram::NotifyRx, &flow));
+  return m_flows.size () - 1;
+}
+
+inline void
+ThroughputHistogram::Add (ApplicationContainer sinks)
+{
+  for (ApplicationContainer::Iterator it = sinks.Begin (); it != sinks.End (); ++it)
+    {
+      Add (DynamicCast<PacketSink> (*it));
+    }
+}
+
+inline uint32_t
+ThroughputHistogram::GetN (void) const
+{
+  return m_flows.size ();
+}
+
+inline uint64_t
+ThroughputHistogram::GetTotalBytes (uint32_t flow) const
+{
+  return m_flows[flow].totalBytes;
+}
+
+inline uint32_t
+ThroughputHistogram::GetNBuckets (uint32_t flow) const
+{
+  return m_flows[flow].buckets.size ();
+}
+
+inline void
+ThroughputHistogram::NotifyRx (Flow *flow, Ptr<const Packet> packet, const Address &from)
+{
+  int64_t index = Simulator::Now ().GetTimeStep () / flow->width;
+  uint32_t size = packet->GetSize ();
+  // Receive times never decrease, so only the newest bucket can match.
+  if (flow->buckets.empty () || flow->buckets.back ().index != index)
+    {
+      Bucket bucket = { index, 0 };
+      flow->buckets.push_back (bucket);
+    }
+  flow->buckets.back ().bytes += size;
+  flow->totalBytes += size;
+}
+
+inline std::vector<double>
+ThroughputHistogram::GetThroughput (uint32_t flow, Time resolution, Time start, Time stop) const
+{
+  int64_t width = m_flows[flow].width;
+  int64_t step = resolution.GetTimeStep ();
+  int64_t begin = start.GetTimeStep ();
+  NS_ASSERT_MSG (step > 0 && step % width == 0, "Resolution must be a multiple of BucketWidth");
+  NS_ASSERT_MSG (begin % width == 0, "Start must be a multiple of BucketWidth");
+
+  int64_t n = stop > start ? (stop.GetTimeStep () - begin + step - 1) / step : 0;
+  std::vector<double> series (n, 0.0);
+  const std::vector<Bucket> &buckets = m_flows[flow].buckets;
+  for (std::vector<Bucket>::const_iterator it = buckets.begin (); it != buckets.end (); ++it)
+    {
+      int64_t offset = it->index * width - begin;
+      if (offset >= 0 && offset / step < n)
+        {
+          series[offset / step] += it->bytes;
+        }
+    }
+
+  double scale = 8.0 / resolution.GetSeconds ();
+  for (int64_t i = 0; i < n; ++i)
+    {
+      series[i] *= scale;
+    }
+  return series;
+}
+
+inline void
+ThroughputHistogram::Print (std::ostream &os, Time resolution, Time start, Time stop, double unit) const
+{
+  std::vector<std::vector<double> > series;
+  series.reserve (m_flows.size ());
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      series.push_back (GetThroughput (i, resolution, start, stop));
+    }
+
+  os << "# time";
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      os << " flow" << i;
+    }
+  os << '\n';
+
+  uint32_t n = series.empty () ? 0 : series[0].size ();
+  std::string row;
+  char field[32];
+  for (uint32_t k = 0; k < n; ++k)
+    {
+      row.clear ();
+      std::snprintf (field, sizeof (field), "%g", (start + TimeStep (resolution.GetTimeStep () * (k + 1))).GetSeconds ());
+      row += field;
+      for (uint32_t i = 0; i < series.size (); ++i)
+        {
+          std::snprintf (field, sizeof (field), " %g", series[i][k] / unit);
+          row += field;
+        }
+      row += '\n';
+      os.write (row.data (), row.size ());
+    }
+}
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_HISTOGRAM_H */
@@ -0,0 +1,293 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef THROUGHPUT_SAMPLER_H
+#define THROUGHPUT_SAMPLER_H
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "time-series-store.h"
+
+// ===========================================================================
+//
+// Periodic receive-throughput sampling for any number of PacketSinks.  This
+// replaces the CalculateThroughput functions of the scratch scripts and
+// their fixed-size lastTotalRx arrays.  Every interval the sampler reads all
+// sinks once, keeping the previous totals in one contiguous vector, and
+// appends a single row to one buffered file:
+//
+//   # time flow0 flow1 ...
+//   1.2 0.83 0.79 ...
+//
+// with the throughput of each sink over the last interval in the chosen
+// unit (bit/s divided by Unit).
+//
+//   Ptr<ThroughputSampler> sampler = CreateObject<ThroughputSampler> ();
+//   sampler->Add (sinkApps);
+//   sampler->Start ("throughput.dat", Seconds (1.1), MilliSeconds (100));
+//
+// Started with a TimeSeriesStore instead of a file name, the sampler appends
+// each sink's throughput to the series "<prefix><i>" of the store, by
+// default "throughput<i>".  The series are created on the first start and
+// appended to again after a restart; samplers sharing a store need
+// different prefixes.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Samples the throughput of a set of PacketSinks into one file.
+ */
+class ThroughputSampler : public Object
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  ThroughputSampler ();
+  virtual ~ThroughputSampler ();
+
+  /**
+   * \param sink the sink to sample
+   * \return the column of the sink in the output
+   */
+  uint32_t Add (Ptr<PacketSink> sink);
+  /**
+   * \param sinks PacketSink applications to sample, in column order
+   */
+  void Add (ApplicationContainer sinks);
+  /**
+   * \return the number of sampled sinks
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * Start sampling.
+   * \param filename the output file
+   * \param start time of the first sample
+   * \param interval time between samples
+   */
+  void Start (std::string filename, Time start, Time interval);
+  /**
+   * Start sampling into \p store, one series "<prefix><i>" per sink.
+   * \param store the store to append to
+   * \param start time of the first sample
+   * \param interval time between samples
+   * \param prefix the series name prefix, unique to this sampler
+   */
+  void Start (Ptr<TimeSeriesStore> store, Time start, Time interval, std::string prefix = "throughput");
+  /**
+   * Stop sampling and flush the output.
+   */
+  void Stop (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void Schedule (Time start, Time interval);
+  void Sample (void);
+
+  std::vector<Ptr<PacketSink> > m_sinks;
+  std::vector<uint64_t>         m_lastRx;
+  Ptr<TimeSeriesStore>          m_store;
+  bool                          m_toStore;
+  std::vector<uint32_t>         m_series;  //!< series of each sink in m_store
+  std::string                   m_prefix;
+  std::vector<char>             m_buffer;  //!< the buffer of m_out, so declared before it
+  std::ofstream                 m_out;
+  std::string                   m_row;
+  Time                          m_interval;
+  double                        m_unit;
+  EventId                       m_event;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ThroughputSampler);
+
+inline TypeId
+ThroughputSampler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ThroughputSampler")
+    .SetParent<Object> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<ThroughputSampler> ()
+    .AddAttribute ("Unit",
+                   "The throughput unit in bit/s, e.g. 1e6 for Mbit/s.",
+                   DoubleValue (1e6),
+                   MakeDoubleAccessor (&ThroughputSampler::m_unit),
+                   MakeDoubleChecker<double> (std::numeric_limits<double>::min ()))
+    ;
+  return tid;
+}
+
+inline
+ThroughputSampler::ThroughputSampler ()
+  : m_toStore (false),
+    m_unit (1e6)
+{
+}
+
+inline
+ThroughputSampler::~ThroughputSampler ()
+{
+}
+
+inline void
+ThroughputSampler::DoDispose (void)
+{
+  Stop ();
+  m_sinks.clear ();
+  m_store = 0;
+  Object::DoDispose ();
+}
+
+inline uint32_t
+ThroughputSampler::Add (Ptr<PacketSink> sink)
+{
+  m_sinks.push_back (sink);
+  m_lastRx.push_back (0);
+  return m_sinks.size () - 1;
+}
+
+inline void
+ThroughputSampler::Add (ApplicationContainer sinks)
+{
+  m_sinks.reserve (m_sinks.size () + sinks.GetN ());
+  m_lastRx.reserve (m_lastRx.size () + sinks.GetN ());
+  for (ApplicationContainer::Iterator it = sinks.Begin (); it != sinks.End (); ++it)
+    {
+      Add (DynamicCast<PacketSink> (*it));
+    }
+}
+
+inline uint32_t
+ThroughputSampler::GetN (void) const
+{
+  return m_sinks.size ();
+}
+
+inline void
+ThroughputSampler::Start (std::string filename, Time start, Time interval)
+{
+  Stop ();
+  m_toStore = false;
+
+  // A large stream buffer: rows are flushed in bulk, never per sample.
+  m_buffer.resize (1 << 16);
+  m_out.rdbuf ()->pubsetbuf (m_buffer.data (), m_buffer.size ());
+  m_out.open (filename.c_str (), std::ios::out);
+  if (!m_out)
+    {
+      NS_FATAL_ERROR ("Cannot open throughput file " << filename);
+    }
+
+  m_out << "# time";
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      m_out << " flow" << i;
+    }
+  m_out << '\n';
+  Schedule (start, interval);
+}
+
+inline void
+ThroughputSampler::Start (Ptr<TimeSeriesStore> store, Time start, Time interval)
+{
+  Stop ();
+  if (store != m_store || prefix != m_prefix)
+    {
+      m_store = store;
+      m_prefix = prefix;
+      m_series.clear ();
+    }
+  // Sinks added since the last start get new series
+  for (uint32_t i = m_series.size (); i < m_sinks.size (); ++i)
+    {
+      m_series.push_back (store->AddSeries (prefix + std::to_string (i)));
+    }
+  m_toStore = true;
+  Schedule (start, interval);
+}
+
+inline void
+ThroughputSampler::Schedule (Time start, Time interval)
+{
+  NS_ASSERT (interval.IsStrictlyPositive ());
+  m_interval = interval;
+  for (uint32_t i = 0; i < m_sinks.size (); ++i)
+    {
+      m_lastRx[i] = m_sinks[i]->GetTotalRx ();
+    }
+  m_event = Simulator::Schedule (start - Simulator::Now (), &ThroughputSampler::Sample, this);
+}
+
+inline void
+ThroughputSampler::Stop (void)
+{
+  Simulator::Cancel (m_event);
+  if (m_out.is_open ())
+    {
+      m_out.close ();
+    }
+}
+
+inline void
+ThroughputSampler::Sample (void)
+{
+  double scale = 8.0 / m_interval.GetSeconds () / m_unit;
+
+  if (m_toStore)
+    {
+      for (uint32_t i = 0; i < m_sinks.size (); ++i)
+        {
+          uint64_t rx = m_sinks[i]->GetTotalRx ();
+          m_store->Append (m_series[i], (rx - m_lastRx[i]) * scale);
+          m_lastRx[i] = rx;
+        }
+    }
+  else
+    {
+      char field[32];
+      m_row.clear ();
+      std::snprintf (field, sizeof (field), "%g", Simulator::Now ().GetSeconds ());
+      m_row += field;
+      for (uint32_t i = 0; i < m_sinks.size (); ++i)
+        {
+          uint64_t rx = m_sinks[i]->GetTotalRx ();
+          std::snprintf (field, sizeof (field), " %g", (rx - m_lastRx[i]) * scale);
+          m_row += field;
+          m_lastRx[i] = rx;
+        }
+      m_row += '\n';
+      m_out.write (m_row.data (), m_row.size ());
+    }
+
+  m_event = Simulator::Schedule (m_interval, &ThroughputSampler::Sample, this);
+}
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SAMPLER_H */
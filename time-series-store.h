@@ -0,0 +1,509 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TIME_SERIES_STORE_H
+#define TIME_SERIES_STORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+
+// ===========================================================================
+//
+// An in-memory store for the metrics a run produces: tracers and samplers
+// append (time, value) pairs to named series instead of writing text files,
+// the script queries the series after Simulator::Run, and one Export writes
+// everything in a single binary file.
+//
+// Each series is columnar: times and values live in separate arrays, split
+// into chunks of ChunkSize samples that are allocated whole, so appending
+// never moves earlier samples.  Range queries find the first chunk by binary
+// search on the chunk start times.  Appends must be in time order, which
+// holds for anything driven by the simulator clock.
+//
+//   Ptr<TimeSeriesStore> store = CreateObject<TimeSeriesStore> ();
+//   uint32_t cwnd = store->AddSeries ("cwnd0");
+//   store->Append (cwnd, newCwnd);                      // in a trace sink
+//   ...
+//   double mean = store->Aggregate (cwnd, Seconds (2), Seconds (10),
+//                                   TimeSeriesStore::MEAN);
+//   store->Export ("run.tsdb");
+//
+// The export is little-endian and laid out as
+//
+//   "NS3TSDB\0" uint32 nSeries uint32 0
+//   per series: uint32 nameLength, name, zeros up to a multiple of 8 bytes,
+//               uint64 count, int64 time[count] (ns), double value[count]
+//
+// so every column starts 8-byte aligned and can be memory-mapped or read
+// with numpy.fromfile.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Columnar in-memory storage of named time series.
+ */
+class TimeSeriesStore : public Object
+{
+public:
+  /// Reductions for Aggregate and Resample.
+  enum Reduction
+  {
+    COUNT,
+    SUM,
+    MEAN,
+    MIN,
+    MAX,
+    LAST
+  };
+
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  TimeSeriesStore ();
+  virtual ~TimeSeriesStore ();
+
+  /**
+   * \param name the series name, unique in the store
+   * \return the series index to append to
+   */
+  uint32_t AddSeries (std::string name);
+  /**
+   * \param name a series name
+   * \return the index of the series
+   */
+  uint32_t GetSeries (std::string name) const;
+  /**
+   * \return the number of series
+   */
+  uint32_t GetNSeries (void) const;
+  /**
+   * \param series the series index
+   * \return the name of the series
+   */
+  std::string GetName (uint32_t series) const;
+  /**
+   * \param series the series index
+   * \return the number of samples in the series
+   */
+  uint64_t GetCount (uint32_t series) const;
+
+  /**
+   * Append \p value at the current simulation time.
+   * \param series the series index
+   * \param value the value
+   */
+  void Append (uint32_t series, double value);
+  /**
+   * Append \p value at \p time, not before the last sample of the series.
+   * \param series the series index
+   * \param time the sample time
+   * \param value the value
+   */
+  void Append (uint32_t series, Time time, double value);
+
+  /**
+   * Copy the samples in [\p from, \p to).
+   * \param series the series index
+   * \param from the start of the range
+   * \param to the end of the range
+   * \param times the sample times
+   * \param values the sample values
+   */
+  void GetRange (uint32_t series, Time from, Time to,
+                 std::vector<Time> &times, std::vector<double> &values) const;
+  /**
+   * Reduce the samples in [\p from, \p to).
+   * \param series the series index
+   * \param from the start of the range
+   * \param to the end of the range
+   * \param reduction the reduction
+   * \return the result; NaN for MEAN, MIN, MAX and LAST of an empty range
+   */
+  double Aggregate (uint32_t series, Time from, Time to, Reduction reduction) const;
+  /**
+   * Reduce the samples of every \p step from \p from to \p to.
+   * \param series the series index
+   * \param from the start of the first interval
+   * \param to the end of the last interval
+   * \param step the interval width
+   * \param reduction the reduction
+   * \return one result per interval, as for Aggregate
+   */
+  std::vector<double> Resample (uint32_t series, Time from, Time to, Time step, Reduction reduction) const;
+
+  /**
+   * Write every series to \p filename.
+   * \param filename the output file
+   */
+  void Export (std::string filename) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// A fixed-capacity block of samples.
+  struct Chunk
+  {
+    std::vector<int64_t> time;  //!< sample times in ns
+    std::vector<double>  value; //!< sample values
+  };
+
+  /// A named series.
+  struct Series
+  {
+    std::string        name;   //!< series name
+    std::vector<Chunk> chunks; //!< the samples, in time order
+    uint64_t           count;  //!< total number of samples
+  };
+
+  /// Running state of a reduction.
+  struct Accumulator
+  {
+    uint64_t count; //!< samples seen
+    double sum;     //!< their sum
+    double min;     //!< their minimum
+    double max;     //!< their maximum
+    double last;    //!< the latest
+  };
+
+  template <class Visitor>
+  void Visit (uint32_t series, int64_t from, int64_t to, Visitor &visitor) const;
+  static void Reset (Accumulator &acc);
+  static void Add (Accumulator &acc, double value);
+  static double Result (const Accumulator &acc, Reduction reduction);
+
+  uint32_t                        m_chunkSize;
+  std::vector<Series>             m_series;
+  std::map<std::string, uint32_t> m_names;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TimeSeriesStore);
+
+inline TypeId
+TimeSeriesStore::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TimeSeriesStore")
+    .SetParent<Object> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<TimeSeriesStore> ()
+    .AddAttribute ("ChunkSize",
+                   "The number of samples allocated at once for a series.",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&TimeSeriesStore::m_chunkSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+inline
+TimeSeriesStore::TimeSeriesStore ()
+  : m_chunkSize (4096)
+{
+}
+
+inline
+TimeSeriesStore::~TimeSeriesStore ()
+{
+}
+
+inline void
+TimeSeriesStore::DoDispose (void)
+{
+  m_series.clear ();
+  m_names.clear ();
+  Object::DoDispose ();
+}
+
+inline uint32_t
+TimeSeriesStore::AddSeries (std::string name)
+{
+  if (m_names.find (name) != m_names.end ())
+    {
+      NS_FATAL_ERROR ("Series " << name << " already exists");
+    }
+  Series series;
+  series.name = name;
+  series.count = 0;
+  m_series.push_back (series);
+  m_names[name] = m_series.size () - 1;
+  return m_series.size () - 1;
+}
+
+inline uint32_t
+TimeSeriesStore::GetSeries (std::string name) const
+{
+  std::map<std::string, uint32_t>::const_iterator it = m_names.find (name);
+  if (it == m_names.end ())
+    {
+      NS_FATAL_ERROR ("No series " << name);
+    }
+  return it->second;
+}
+
+inline uint32_t
+TimeSeriesStore::GetNSeries (void) const
+{
+  return m_series.size ();
+}
+
+inline std::string
+TimeSeriesStore::GetName (uint32_t series) const
+{
+  return m_series[series].name;
+}
+
+inline uint64_t
+TimeSeriesStore::GetCount (uint32_t series) const
+{
+  return m_series[series].count;
+}
+
+inline void
+TimeSeriesStore::Append (uint32_t series, double value)
+{
+  Append (series, Simulator::Now (), value);
+}
+
+inline void
+TimeSeriesStore::Append (uint32_t series, Time time, double value)
+{
+  Series &s = m_series[series];
+  NS_ASSERT_MSG (s.chunks.empty () || s.chunks.back ().time.back () <= time.GetNanoSeconds (),
+                 "Samples must be appended in time order");
+  if (s.chunks.empty () || s.chunks.back ().time.size () == s.chunks.back ().time.capacity ())
+    {
+      s.chunks.push_back (Chunk ());
+      s.chunks.back ().time.reserve (m_chunkSize);
+      s.chunks.back ().value.reserve (m_chunkSize);
+    }
+  Chunk &chunk = s.chunks.back ();
+  chunk.time.push_back (time.GetNanoSeconds ());
+  chunk.value.push_back (value);
+  ++s.count;
+}
+
+template <class Visitor>
+void
+TimeSeriesStore::Visit (uint32_t series, int64_t from, int64_t to, Visitor &visitor) const
+{
+  const std::vector<Chunk> &chunks = m_series[series].chunks;
+  // The last chunk starting before from holds the first sample in range;
+  // equal times may cross a chunk boundary, so a chunk starting at from
+  // can follow samples at from.
+  std::vector<Chunk>::const_iterator chunk = chunks.begin ();
+  std::vector<Chunk>::const_iterator lo = chunks.begin ();
+  std::vector<Chunk>::const_iterator hi = chunks.end ();
+  while (lo != hi)
+    {
+      std::vector<Chunk>::const_iterator mid = lo + (hi - lo) / 2;
+      if (mid->time.front () < from)
+        {
+          chunk = mid;
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  for (; chunk != chunks.end (); ++chunk)
+    {
+      if (chunk->time.front () >= to)
+        {
+          return;
+        }
+      size_t i = std::lower_bound (chunk->time.begin (), chunk->time.end (), from) - chunk->time.begin ();
+      for (; i < chunk->time.size () && chunk->time[i] < to; ++i)
+        {
+          visitor (chunk->time[i], chunk->value[i]);
+        }
+    }
+}
+
+inline void
+TimeSeriesStore::Reset (Accumulator &acc)
+{
+  acc.count = 0;
+  acc.sum = 0;
+  acc.min = std::numeric_limits<double>::infinity ();
+  acc.max = -std::numeric_limits<double>::infinity ();
+  acc.last = 0;
+}
+
+inline void
+TimeSeriesStore::Add (Accumulator &acc, double value)
+{
+  ++acc.count;
+  acc.sum += value;
+  acc.min = std::min (acc.min, value);
+  acc.max = std::max (acc.max, value);
+  acc.last = value;
+}
+
+inline double
+TimeSeriesStore::Result (const Accumulator &acc, Reduction reduction)
+{
+  switch (reduction)
+    {
+    case COUNT:
+      return acc.count;
+    case SUM:
+      return acc.sum;
+    default:
+      break;
+    }
+  if (acc.count == 0)
+    {
+      return std::numeric_limits<double>::quiet_NaN ();
+    }
+  switch (reduction)
+    {
+    case MEAN:
+      return acc.sum / acc.count;
+    case MIN:
+      return acc.min;
+    case MAX:
+      return acc.max;
+    default:
+      return acc.last;
+    }
+}
+
+inline void
+TimeSeriesStore::GetRange (uint32_t series, Time from, Time to,
+                           std::vector<Time> &times, std::vector<double> &values) const
+{
+  struct Collector
+  {
+    std::vector<Time> *times;
+    std::vector<double> *values;
+    void operator() (int64_t time, double value)
+    {
+      times->push_back (NanoSeconds (time));
+      values->push_back (value);
+    }
+  } collector;
+  times.clear ();
+  values.clear ();
+  collector.times = &times;
+  collector.values = &values;
+  Visit (series, from.GetNanoSeconds (), to.GetNanoSeconds (), collector);
+}
+
+inline double
+TimeSeriesStore::Aggregate (uint32_t series, Time from, Time to, Reduction reduction) const
+{
+  struct Reducer
+  {
+    Accumulator acc;
+    void operator() (int64_t time, double value)
+    {
+      TimeSeriesStore::Add (acc, value);
+    }
+  } reducer;
+  Reset (reducer.acc);
+  Visit (series, from.GetNanoSeconds (), to.GetNanoSeconds (), reducer);
+  return Result (reducer.acc, reduction);
+}
+
+inline std::vector<double>
+TimeSeriesStore::Resample (uint32_t series, Time from, Time to, Time step, Reduction reduction) const
+{
+  NS_ASSERT (step.IsStrictlyPositive ());
+  int64_t begin = from.GetNanoSeconds ();
+  int64_t width = step.GetNanoSeconds ();
+  int64_t n = to > from ? (to.GetNanoSeconds () - begin + width - 1) / width : 0;
+
+  // One pass over the range, binning each sample into its interval
+  struct Binner
+  {
+    std::vector<Accumulator> bins;
+    int64_t begin;
+    int64_t width;
+    void operator() (int64_t time, double value)
+    {
+      TimeSeriesStore::Add (bins[(time - begin) / width], value);
+    }
+  } binner;
+  binner.bins.resize (n);
+  binner.begin = begin;
+  binner.width = width;
+  for (int64_t i = 0; i < n; ++i)
+    {
+      Reset (binner.bins[i]);
+    }
+  Visit (series, begin, begin + n * width, binner);
+
+  std::vector<double> result (n);
+  for (int64_t i = 0; i < n; ++i)
+    {
+      result[i] = Result (binner.bins[i], reduction);
+    }
+  return result;
+}
+
+inline void
+TimeSeriesStore::Export (std::string filename) const
+{
+  std::FILE *out = std::fopen (filename.c_str (), "wb");
+  if (out == 0)
+    {
+      NS_FATAL_ERROR ("Cannot create " << filename);
+    }
+  char magic[8];
+  std::memset (magic, 0, sizeof (magic));
+  std::strncpy (magic, "NS3TSDB", sizeof (magic));
+  uint32_t header[2] = { static_cast<uint32_t> (m_series.size ()), 0 };
+  std::fwrite (magic, sizeof (magic), 1, out);
+  std::fwrite (header, sizeof (header), 1, out);
+
+  for (std::vector<Series>::const_iterator s = m_series.begin (); s != m_series.end (); ++s)
+    {
+      uint32_t length = s->name.size ();
+      std::fwrite (&length, sizeof (length), 1, out);
+      std::fwrite (s->name.data (), 1, length, out);
+      // The file position is a multiple of 8 before the length
+      static const char zeros[8] = { 0 };
+      std::fwrite (zeros, 1, (8 - (sizeof (length) + length) % 8) % 8, out);
+      std::fwrite (&s->count, sizeof (s->count), 1, out);
+      for (std::vector<Chunk>::const_iterator c = s->chunks.begin (); c != s->chunks.end (); ++c)
+        {
+          std::fwrite (c->time.data (), sizeof (int64_t), c->time.size (), out);
+        }
+      for (std::vector<Chunk>::const_iterator c = s->chunks.begin (); c != s->chunks.end (); ++c)
+        {
+          std::fwrite (c->value.data (), sizeof (double), c->value.size (), out);
+        }
+    }
+  std::fclose (out);
+}
+
+} // namespace ns3
+
+#endif /* TIME_SERIES_STORE_H */
@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <string>
+#include "ns3/core-module.h"
+#include "trace-writer.h"
+#include "flow-stats-view.h"
+#include "flow-stats-file.h"
+
+// Converts a binary trace written by TraceWriter into the text data files
+// of its channels, e.g. after a tcp-pacing run:
+//
+//   ./waf --run "trace-convert --input=tcp-dynamic-pacing.trbin"
+//
+// and prints a flow snapshot file written by FlowStatsSnapshot:
+//
+//   ./waf --run "trace-convert --flows=taska1.snap"
+//
+// and prints a flow statistics file written by FlowStatsWriter:
+//
+//   ./waf --run "trace-convert --flowstats=lab-2.flowbin"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TraceConvert");
+
+int
+main (int argc, char *argv[])
+{
+  std::string input = "tcp-dynamic-pacing.trbin";
+  std::string flows = "";
+  std::string flowStats = "";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("input", "The binary trace to convert", input);
+  cmd.AddValue ("flows", "A flow snapshot file to print instead", flows);
+  cmd.AddValue ("flowstats", "A flow statistics file to print instead", flowStats);
+  cmd.Parse (argc, argv);
+
+  if (!flows.empty ())
+    {
+      FlowStatsSnapshot::Convert (flows, std::cout);
+      return 0;
+    }
+  if (!flowStats.empty ())
+    {
+      FlowStatsReader::Print (flowStats, std::cout);
+      return 0;
+    }
+
+  uint64_t records = TraceWriter::Convert (input);
+  std::cout << "Converted " << records << " records from " << input << std::endl;
+  return 0;
+}
@@ -0,0 +1,430 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACE_REPLAY_SOURCE_H
+#define TRACE_REPLAY_SOURCE_H
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+// ===========================================================================
+//
+// Replays recorded packet timings into sockets.  The trace is a binary file:
+//
+//   TraceReplayHeader   magic "NS3TRPL" and record count
+//   TraceReplayRecord[] (timestamp, size, flowId), sorted by flowId and then
+//                       by timestamp; timestamps are nanoseconds from the
+//                       start of the trace
+//
+// TraceReplaySource::Write produces such a file from a record vector.  The
+// file is mapped read-only, so only the pages under each flow's cursor are
+// resident, and each flow has exactly one pending event: the send of its
+// next record.  Use it like the other socket-driven senders:
+//
+//   Ptr<TraceReplaySource> replay = CreateObject<TraceReplaySource> ();
+//   replay->SetAttribute ("TraceFile", StringValue ("flows.trpl"));
+//   for (...)
+//     {
+//       Ptr<Socket> socket = Socket::CreateSocket (node, TcpSocketFactory::GetTypeId ());
+//       replay->Setup (flowId, socket, sinkAddress);
+//     }
+//   node->AddApplication (replay);
+//
+// Trace time zero is the application start time.  A record the socket
+// refuses for lack of buffer space is sent late, from the socket's send
+// callback, and holds back the later records of its flow; one larger than
+// the whole send buffer (SndBufSize for TCP, the largest datagram for UDP)
+// or refused for another reason is skipped.  Both count as send failures.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief One packet of a replay trace.
+ */
+struct TraceReplayRecord
+{
+  uint64_t timestamp; //!< nanoseconds since the start of the trace
+  uint32_t size;      //!< packet size in bytes
+  uint32_t flowId;    //!< flow the packet belongs to
+};
+
+/**
+ * \brief The file header of a replay trace.
+ */
+struct TraceReplayHeader
+{
+  char magic[8];  //!< "NS3TRPL" and a terminating zero
+  uint64_t count; //!< number of records that follow
+};
+
+/**
+ * \brief Sends the packets of a memory-mapped trace file, one socket per flow.
+ */
+class TraceReplaySource : public Application
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  TraceReplaySource ();
+  virtual ~TraceReplaySource ();
+
+  /**
+   * Replay the records of \p flowId into \p socket.
+   * \param flowId the flow id used in the trace
+   * \param socket the socket to send on; it is bound and connected at start
+   * \param address the peer address
+   */
+  void Setup (uint32_t flowId, Ptr<Socket> socket, Address address);
+
+  /**
+   * \return the number of records sent so far
+   */
+  uint64_t GetRecordsSent (void) const;
+  /**
+   * \return the number of sends the sockets refused
+   */
+  uint64_t GetSendFailures (void) const;
+
+  /**
+   * Write \p records as a replay trace.  Records already sorted by flow
+   * and time are written as they are; otherwise a sorted copy is written.
+   * \param filename the output file
+   * \param records the records, in any order
+   */
+  static void Write (std::string filename, const std::vector<TraceReplayRecord> &records);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  /// A replayed flow and its cursor into the mapped records.
+  struct Flow
+  {
+    uint32_t id;                     //!< flow id in the trace
+    Ptr<Socket> socket;              //!< socket to send on
+    Address peer;                    //!< peer address
+    const TraceReplayRecord *next;   //!< next record to send
+    const TraceReplayRecord *end;    //!< one past the last record of the flow
+    EventId event;                   //!< pending send of *next
+    bool blocked;                    //!< waiting for room in the socket buffer
+    uint32_t capacity;               //!< the largest record the socket can ever take
+  };
+
+  void Map (void);
+  void Unmap (void);
+  void ScheduleNext (uint32_t index);
+  void SendRecords (uint32_t index);
+  static void SendSpaceAvailable (TraceReplaySource *source, uint32_t index, Ptr<Socket> socket, uint32_t available);
+
+  static bool CompareFlow (const TraceReplayRecord &a, const TraceReplayRecord &b);
+  static bool CompareFlowAndTime (const TraceReplayRecord &a, const TraceReplayRecord &b);
+
+  std::string                 m_filename;
+  std::vector<Flow>           m_flows;
+  void                       *m_map;
+  size_t                      m_mapSize;
+  const TraceReplayRecord    *m_records;
+  uint64_t                    m_count;
+  Time                        m_origin;
+  uint64_t                    m_recordsSent;
+  uint64_t                    m_sendFailures;
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TraceReplaySource);
+
+inline TypeId
+TraceReplaySource::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TraceReplaySource")
+    .SetParent<Application> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<TraceReplaySource> ()
+    .AddAttribute ("TraceFile",
+                   "The replay trace to map.",
+                   StringValue (""),
+                   MakeStringAccessor (&TraceReplaySource::m_filename),
+                   MakeStringChecker ())
+    .AddTraceSource ("Tx", "A new packet is created and is sent",
+                     MakeTraceSourceAccessor (&TraceReplaySource::m_txTrace),
+                     "ns3::Packet::TracedCallback")
+    ;
+  return tid;
+}
+
+inline
+TraceReplaySource::TraceReplaySource ()
+  : m_map (0),
+    m_mapSize (0),
+    m_records (0),
+    m_count (0),
+    m_recordsSent (0),
+    m_sendFailures (0)
+{
+}
+
+inline
+TraceReplaySource::~TraceReplaySource ()
+{
+  Unmap ();
+}
+
+inline void
+TraceReplaySource::DoDispose (void)
+{
+  m_flows.clear ();
+  Unmap ();
+  Application::DoDispose ();
+}
+
+inline void
+TraceReplaySource::Setup (uint32_t flowId, Ptr<Socket> socket, Address address)
+{
+  Flow flow;
+  flow.id = flowId;
+  flow.socket = socket;
+  flow.peer = address;
+  flow.next = 0;
+  flow.end = 0;
+  flow.blocked = false;
+  flow.capacity = 0;
+  m_flows.push_back (flow);
+}
+
+inline uint64_t
+TraceReplaySource::GetRecordsSent (void) const
+{
+  return m_recordsSent;
+}
+
+inline uint64_t
+TraceReplaySource::GetSendFailures (void) const
+{
+  return m_sendFailures;
+}
+
+inline bool
+TraceReplaySource::CompareFlow (const TraceReplayRecord &a, const TraceReplayRecord &b)
+{
+  return a.flowId < b.flowId;
+}
+
+inline bool
+TraceReplaySource::CompareFlowAndTime (const TraceReplayRecord &a, const TraceReplayRecord &b)
+{
+  return a.flowId < b.flowId || (a.flowId == b.flowId && a.timestamp < b.timestamp);
+}
+
+inline void
+TraceReplaySource::Map (void)
+{
+  int fd = open (m_filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_FATAL_ERROR ("Cannot open replay trace " << m_filename);
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || static_cast<size_t> (st.st_size) < sizeof (TraceReplayHeader))
+    {
+      close (fd);
+      NS_FATAL_ERROR ("Replay trace " << m_filename << " is truncated");
+    }
+  m_mapSize = st.st_size;
+  m_map = mmap (0, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (m_map == MAP_FAILED)
+    {
+      m_map = 0;
+      NS_FATAL_ERROR ("Cannot map replay trace " << m_filename);
+    }
+
+  const TraceReplayHeader *header = static_cast<const TraceReplayHeader *> (m_map);
+  if (std::strncmp (header->magic, "NS3TRPL", sizeof (header->magic)) != 0
+      || (m_mapSize - sizeof (TraceReplayHeader)) % sizeof (TraceReplayRecord) != 0
+      || header->count != (m_mapSize - sizeof (TraceReplayHeader)) / sizeof (TraceReplayRecord))
+    {
+      NS_FATAL_ERROR ("Replay trace " << m_filename << " is not a valid trace");
+    }
+  m_count = header->count;
+  m_records = reinterpret_cast<const TraceReplayRecord *> (header + 1);
+}
+
+inline void
+TraceReplaySource::Unmap (void)
+{
+  if (m_map != 0)
+    {
+      munmap (m_map, m_mapSize);
+      m_map = 0;
+      m_mapSize = 0;
+      m_records = 0;
+      m_count = 0;
+    }
+}
+
+inline void
+TraceReplaySource::StartApplication (void)
+{
+  if (m_map == 0)
+    {
+      Map ();
+    }
+  m_origin = Simulator::Now ();
+
+  for (uint32_t i = 0; i < m_flows.size (); ++i)
+    {
+      Flow &flow = m_flows[i];
+      // Records are grouped by flow, so each flow's range is found by a
+      // binary search that touches only O(log n) pages of the trace.
+      TraceReplayRecord key = { 0, 0, flow.id };
+      std::pair<const TraceReplayRecord *, const TraceReplayRecord *> range =
+        std::equal_range (m_records, m_records + m_count, key, CompareFlow);
+      flow.next = range.first;
+      flow.end = range.second;
+      flow.blocked = false;
+
+      if (InetSocketAddress::IsMatchingType (flow.peer))
+        {
+          flow.socket->Bind ();
+        }
+      else
+        {
+          flow.socket->Bind6 ();
+        }
+      flow.socket->Connect (flow.peer);
+      // An empty TCP buffer takes SndBufSize bytes; other sockets report
+      // a constant, such as the largest UDP datagram.
+      UintegerValue sndBufSize;
+      flow.capacity = flow.socket->GetAttributeFailSafe ("SndBufSize", sndBufSize)
+        ? static_cast<uint32_t> (sndBufSize.Get ()) : flow.socket->GetTxAvailable ();
+      flow.socket->SetSendCallback (MakeBoundCallback (&TraceReplaySource::SendSpaceAvailable, this, i));
+      ScheduleNext (i);
+    }
+}
+
+inline void
+TraceReplaySource::StopApplication (void)
+{
+  for (std::vector<Flow>::iterator it = m_flows.begin (); it != m_flows.end (); ++it)
+    {
+      Simulator::Cancel (it->event);
+      if (it->socket)
+        {
+          it->socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+          it->socket->Close ();
+        }
+    }
+}
+
+inline void
+TraceReplaySource::ScheduleNext (uint32_t index)
+{
+  Flow &flow = m_flows[index];
+  if (flow.next != flow.end)
+    {
+      Time at = m_origin + NanoSeconds (flow.next->timestamp);
+      flow.event = Simulator::Schedule (at - Simulator::Now (), &TraceReplaySource::SendRecords, this, index);
+    }
+}
+
+inline void
+TraceReplaySource::SendRecords (uint32_t index)
+{
+  Flow &flow = m_flows[index];
+  uint64_t now = (Simulator::Now () - m_origin).GetNanoSeconds ();
+  // Send every record that is due, so packets recorded with the same
+  // timestamp share a single event.
+  while (flow.next != flow.end && flow.next->timestamp <= now)
+    {
+      Ptr<Packet> packet = Create<Packet> (flow.next->size);
+      if (flow.socket->Send (packet) < 0)
+        {
+          ++m_sendFailures;
+          if (flow.next->size <= flow.capacity && flow.socket->GetTxAvailable () < flow.next->size)
+            {
+              // Retried from SendSpaceAvailable
+              flow.blocked = true;
+              return;
+            }
+          // Too large for the socket, or refused with room to spare: the
+          // record can never be sent
+          ++flow.next;
+          continue;
+        }
+      m_txTrace (packet);
+      ++flow.next;
+      ++m_recordsSent;
+    }
+  ScheduleNext (index);
+}
+
+inline void
+TraceReplaySource::SendSpaceAvailable (TraceReplaySource *source, uint32_t index, Ptr<Socket> socket, uint32_t available)
+{
+  Flow &flow = source->m_flows[index];
+  if (flow.blocked && available >= flow.next->size)
+    {
+      flow.blocked = false;
+      source->SendRecords (index);
+    }
+}
+
+inline void
+TraceReplaySource::Write (std::string filename, const std::vector<TraceReplayRecord> &records)
+{
+  if (!std::is_sorted (records.begin (), records.end (), CompareFlowAndTime))
+    {
+      std::vector<TraceReplayRecord> sorted (records);
+      std::sort (sorted.begin (), sorted.end (), CompareFlowAndTime);
+      Write (filename, sorted);
+      return;
+    }
+
+  TraceReplayHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::strncpy (header.magic, "NS3TRPL", sizeof (header.magic));
+  header.count = records.size ();
+
+  std::ofstream out (filename.c_str (), std::ios::out | std::ios::binary);
+  if (!out)
+    {
+      NS_FATAL_ERROR ("Cannot create replay trace " << filename);
+    }
+  out.write (reinterpret_cast<const char *> (&header), sizeof (header));
+  out.write (reinterpret_cast<const char *> (records.data ()), records.size () * sizeof (TraceReplayRecord));
+}
+
+} // namespace ns3
+
+#endif /* TRACE_REPLAY_SOURCE_H */
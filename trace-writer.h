@@ -0,0 +1,370 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ns3/core-module.h"
+
+// ===========================================================================
+//
+// Binary trace output for high-rate tracers.  A trace callback only stores
+// a fixed-size record (time, channel, value) in a single-producer ring
+// buffer; a background thread drains the ring to disk in large writes.  No
+// formatting or flushing happens on the simulation thread.  The file is
+//
+//   TraceWriterHeader        magic "NS3TRCW" and channel count
+//   TraceWriterChannel[]     output file, label and comment of each channel
+//   TraceWriterRecord[]      until the end of the file
+//
+// and TraceWriter::Convert (see trace-convert.cc) turns it back into the
+// usual text files, one line per record:
+//
+//   <time> <value>            for channels without a label
+//   <time> <label> <value>    otherwise; channels may share an output file
+//
+// Channels are added before Open:
+//
+//   TraceWriter traces;
+//   uint32_t cwnd = traces.AddChannel ("cwnd.dat");
+//   traces.Open ("traces.bin");
+//   ...
+//   traces.Write (cwnd, newval);     // from the trace callback
+//   ...
+//   traces.Close ();
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief The file header of a binary trace.
+ */
+struct TraceWriterHeader
+{
+  char magic[8];     //!< "NS3TRCW" and a terminating zero
+  uint32_t channels; //!< number of channel descriptions that follow
+  uint32_t reserved; //!< zero
+};
+
+/**
+ * \brief The description of one channel of a binary trace.
+ */
+struct TraceWriterChannel
+{
+  char file[96];    //!< text file the channel converts to
+  char label[16];   //!< label written before each value, may be empty
+  char comment[80]; //!< first line of the text file, may be empty
+};
+
+/**
+ * \brief One traced value.
+ */
+struct TraceWriterRecord
+{
+  int64_t time;     //!< simulation time in nanoseconds
+  uint32_t channel; //!< index of the channel
+  uint32_t reserved; //!< zero
+  double value;     //!< the traced value
+};
+
+/**
+ * \brief Writes trace records to a binary file from a background thread.
+ */
+class TraceWriter
+{
+public:
+  TraceWriter ();
+  ~TraceWriter ();
+
+  /**
+   * Describe a channel.  Must be called before Open.
+   * \param file the text file the channel converts to
+   * \param label written before each value, for channels sharing a file
+   * \param comment written once at the top of the text file
+   * \return the channel index to pass to Write
+   */
+  uint32_t AddChannel (std::string file, std::string label = "", std::string comment = "");
+
+  /**
+   * Create the trace file and start the writer thread.
+   * \param filename the binary trace file
+   * \param capacity ring buffer size in records, a power of two
+   */
+  void Open (std::string filename, uint32_t capacity = 1 << 16);
+
+  /**
+   * Record \p value on \p channel at the current simulation time.  Only
+   * blocks when the writer thread has fallen a whole ring behind; does
+   * nothing when the writer is not open.
+   * \param channel the channel index
+   * \param value the value
+   */
+  void Write (uint32_t channel, double value);
+
+  /**
+   * Write all pending records, stop the thread and close the file.
+   */
+  void Close (void);
+
+  /**
+   * \return the number of times Write had to wait for a free slot
+   */
+  uint64_t GetStalls (void) const;
+
+  /**
+   * Convert a binary trace to the text files of its channels.
+   * \param filename the binary trace file
+   * \return the number of records converted
+   */
+  static uint64_t Convert (std::string filename);
+
+private:
+  TraceWriter (const TraceWriter &);
+  TraceWriter &operator= (const TraceWriter &);
+
+  void Drain (void);
+
+  std::vector<TraceWriterChannel> m_channels;
+  std::vector<TraceWriterRecord>  m_ring;
+  uint64_t                        m_mask;
+  std::FILE                      *m_file;
+  std::thread                     m_thread;
+  std::atomic<bool>               m_stop;
+  uint64_t                        m_stalls;
+  alignas (64) std::atomic<uint64_t> m_head; //!< next slot to fill, owned by Write
+  alignas (64) std::atomic<uint64_t> m_tail; //!< next slot to drain, owned by Drain
+};
+
+inline
+TraceWriter::TraceWriter ()
+  : m_mask (0),
+    m_file (0),
+    m_stop (false),
+    m_stalls (0),
+    m_head (0),
+    m_tail (0)
+{
+}
+
+inline
+TraceWriter::~TraceWriter ()
+{
+  Close ();
+}
+
+inline uint32_t
+TraceWriter::AddChannel (std::string file, std::string label, std::string comment)
+{
+  NS_ASSERT_MSG (m_file == 0, "Channels must be added before Open");
+  TraceWriterChannel channel;
+  std::memset (&channel, 0, sizeof (channel));
+  std::strncpy (channel.file, file.c_str (), sizeof (channel.file) - 1);
+  std::strncpy (channel.label, label.c_str (), sizeof (channel.label) - 1);
+  std::strncpy (channel.comment, comment.c_str (), sizeof (channel.comment) - 1);
+  m_channels.push_back (channel);
+  return m_channels.size () - 1;
+}
+
+inline void
+TraceWriter::Open (std::string filename, uint32_t capacity)
+{
+  NS_ASSERT_MSG (capacity > 0 && (capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+  Close ();
+
+  m_file = std::fopen (filename.c_str (), "wb");
+  if (m_file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot create trace file " << filename);
+    }
+  std::setvbuf (m_file, 0, _IOFBF, 1 << 20);
+
+  TraceWriterHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::strncpy (header.magic, "NS3TRCW", sizeof (header.magic));
+  header.channels = m_channels.size ();
+  std::fwrite (&header, sizeof (header), 1, m_file);
+  std::fwrite (m_channels.data (), sizeof (TraceWriterChannel), m_channels.size (), m_file);
+
+  m_ring.assign (capacity, TraceWriterRecord ());
+  m_mask = capacity - 1;
+  m_head.store (0, std::memory_order_relaxed);
+  m_tail.store (0, std::memory_order_relaxed);
+  m_stop.store (false, std::memory_order_relaxed);
+  m_thread = std::thread (&TraceWriter::Drain, this);
+}
+
+inline void
+TraceWriter::Write (uint32_t channel, double value)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  uint64_t head = m_head.load (std::memory_order_relaxed);
+  if (head - m_tail.load (std::memory_order_acquire) > m_mask)
+    {
+      ++m_stalls;
+      while (head - m_tail.load (std::memory_order_acquire) > m_mask)
+        {
+          std::this_thread::yield ();
+        }
+    }
+  TraceWriterRecord &record = m_ring[head & m_mask];
+  record.time = Simulator::Now ().GetNanoSeconds ();
+  record.channel = channel;
+  record.reserved = 0;
+  record.value = value;
+  m_head.store (head + 1, std::memory_order_release);
+}
+
+inline void
+TraceWriter::Drain (void)
+{
+  for (;;)
+    {
+      // Read the stop flag first: every record written before Close set
+      // it is then visible in head, so nothing is left behind.
+      bool stopping = m_stop.load (std::memory_order_acquire);
+      uint64_t tail = m_tail.load (std::memory_order_relaxed);
+      uint64_t head = m_head.load (std::memory_order_acquire);
+      if (head == tail)
+        {
+          if (stopping)
+            {
+              break;
+            }
+          std::this_thread::sleep_for (std::chrono::milliseconds (1));
+          continue;
+        }
+      uint64_t begin = tail & m_mask;
+      uint64_t n = std::min (head - tail, m_mask + 1 - begin);
+      std::fwrite (&m_ring[begin], sizeof (TraceWriterRecord), n, m_file);
+      m_tail.store (tail + n, std::memory_order_release);
+    }
+}
+
+inline void
+TraceWriter::Close (void)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  m_stop.store (true, std::memory_order_release);
+  m_thread.join ();
+  std::fclose (m_file);
+  m_file = 0;
+  m_ring.clear ();
+}
+
+inline uint64_t
+TraceWriter::GetStalls (void) const
+{
+  return m_stalls;
+}
+
+inline uint64_t
+TraceWriter::Convert (std::string filename)
+{
+  std::FILE *in = std::fopen (filename.c_str (), "rb");
+  if (in == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open trace file " << filename);
+    }
+  TraceWriterHeader header;
+  if (std::fread (&header, sizeof (header), 1, in) != 1
+      || std::strncmp (header.magic, "NS3TRCW", sizeof (header.magic)) != 0)
+    {
+      std::fclose (in);
+      NS_FATAL_ERROR ("Trace file " << filename << " is not a valid trace");
+    }
+  std::vector<TraceWriterChannel> channels (header.channels);
+  if (std::fread (channels.data (), sizeof (TraceWriterChannel), channels.size (), in) != channels.size ())
+    {
+      std::fclose (in);
+      NS_FATAL_ERROR ("Trace file " << filename << " is truncated");
+    }
+
+  // Channels sharing a text file share its stream
+  std::map<std::string, std::FILE *> files;
+  std::vector<std::FILE *> outputs (channels.size ());
+  for (uint32_t i = 0; i < channels.size (); ++i)
+    {
+      std::string name (channels[i].file, strnlen (channels[i].file, sizeof (channels[i].file)));
+      std::map<std::string, std::FILE *>::iterator it = files.find (name);
+      if (it == files.end ())
+        {
+          std::FILE *out = std::fopen (name.c_str (), "w");
+          if (out == 0)
+            {
+              NS_FATAL_ERROR ("Cannot create " << name);
+            }
+          if (channels[i].comment[0] != '\0')
+            {
+              std::fprintf (out, "%.*s\n", int (sizeof (channels[i].comment)), channels[i].comment);
+            }
+          it = files.insert (std::make_pair (name, out)).first;
+        }
+      outputs[i] = it->second;
+    }
+
+  uint64_t count = 0;
+  std::vector<TraceWriterRecord> block (4096);
+  size_t n;
+  while ((n = std::fread (block.data (), sizeof (TraceWriterRecord), block.size (), in)) > 0)
+    {
+      for (size_t k = 0; k < n; ++k)
+        {
+          const TraceWriterRecord &record = block[k];
+          if (record.channel >= channels.size ())
+            {
+              continue;
+            }
+          const TraceWriterChannel &channel = channels[record.channel];
+          if (channel.label[0] == '\0')
+            {
+              std::fprintf (outputs[record.channel], "%.6f%12.15g\n", record.time / 1e9, record.value);
+            }
+          else
+            {
+              std::fprintf (outputs[record.channel], "%.6f %.*s %.15g\n", record.time / 1e9,
+                            int (sizeof (channel.label)), channel.label, record.value);
+            }
+        }
+      count += n;
+    }
+
+  std::fclose (in);
+  for (std::map<std::string, std::FILE *>::iterator it = files.begin (); it != files.end (); ++it)
+    {
+      std::fclose (it->second);
+    }
+  return count;
+}
+
+} // namespace ns3
+
+#endif /* TRACE_WRITER_H */
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRACED_TCP_SOCKET_FACTORY_H
+#define TRACED_TCP_SOCKET_FACTORY_H
+
+#include <map>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+// ===========================================================================
+//
+// Hooks TCP socket traces at socket creation time.  The scripts used to
+// schedule a ConnectSocketTraces at 1001 us that resolved strings such as
+//
+//   /NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow
+//
+// through the Config path parser, and that missed any socket created after
+// it ran.  TracedTcpSocketFactory is a socket factory aggregated to a node
+// next to TcpL4Protocol.  Every socket it creates fires "SocketCreated" and
+// is connected to the cwnd, ssthresh and pacing-rate callbacks set on the
+// factory before anyone can send on it.  The trace source accessors are
+// looked up once per socket type, so connecting costs the same for the
+// first socket and the ten-thousandth.
+//
+//   Ptr<TracedTcpSocketFactory> factory = TracedTcpSocketFactory::Install (node);
+//   factory->SetCwndCallback (MakeCallback (&CwndTracer));
+//   Ptr<Socket> socket = Socket::CreateSocket (node, TracedTcpSocketFactory::GetTypeId ());
+//
+// Applications that create their own sockets use it through their protocol
+// attribute, e.g. BulkSendHelper ("ns3::TracedTcpSocketFactory", address).
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief A TCP socket factory that connects socket traces at creation.
+ */
+class TracedTcpSocketFactory : public SocketFactory
+{
+public:
+  /// Signature of the CongestionWindow and SlowStartThreshold callbacks.
+  typedef Callback<void, uint32_t, uint32_t> WindowCallback;
+  /// Signature of the PacingRate callback.
+  typedef Callback<void, DataRate, DataRate> RateCallback;
+  /// Signature of the SocketCreated trace source.
+  typedef void (* SocketCreatedCallback)(Ptr<Socket> socket);
+
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  TracedTcpSocketFactory ();
+  virtual ~TracedTcpSocketFactory ();
+
+  /**
+   * Aggregate a factory to \p node, unless it already has one.  The node
+   * must already have TCP installed.
+   * \param node the node
+   * \return the factory of the node
+   */
+  static Ptr<TracedTcpSocketFactory> Install (Ptr<Node> node);
+
+  /**
+   * Create a TCP socket of the node and connect the configured traces.
+   * \return the new socket
+   */
+  virtual Ptr<Socket> CreateSocket (void);
+
+  /**
+   * \param cb connected to the CongestionWindow of every new socket
+   */
+  void SetCwndCallback (WindowCallback cb);
+  /**
+   * \param cb connected to the SlowStartThreshold of every new socket
+   */
+  void SetSsThreshCallback (WindowCallback cb);
+  /**
+   * \param cb connected to the PacingRate of every new socket
+   */
+  void SetPacingRateCallback (RateCallback cb);
+
+  /**
+   * \return the number of sockets created by this factory
+   */
+  uint32_t GetNSockets (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// The trace sources of one socket type.
+  struct Accessors
+  {
+    Ptr<const TraceSourceAccessor> cwnd;       //!< CongestionWindow
+    Ptr<const TraceSourceAccessor> ssThresh;   //!< SlowStartThreshold
+    Ptr<const TraceSourceAccessor> pacingRate; //!< PacingRate
+  };
+
+  static const Accessors &GetAccessors (TypeId tid);
+
+  WindowCallback                      m_cwnd;
+  WindowCallback                      m_ssThresh;
+  RateCallback                        m_pacingRate;
+  uint32_t                            m_nSockets;
+  TracedCallback<Ptr<Socket> >        m_socketCreated;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TracedTcpSocketFactory);
+
+inline TypeId
+TracedTcpSocketFactory::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TracedTcpSocketFactory")
+    .SetParent<SocketFactory> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<TracedTcpSocketFactory> ()
+    .AddTraceSource ("SocketCreated", "A TCP socket was created by this factory",
+                     MakeTraceSourceAccessor (&TracedTcpSocketFactory::m_socketCreated),
+                     "ns3::TracedTcpSocketFactory::SocketCreatedCallback")
+    ;
+  return tid;
+}
+
+inline
+TracedTcpSocketFactory::TracedTcpSocketFactory ()
+  : m_nSockets (0)
+{
+}
+
+inline
+TracedTcpSocketFactory::~TracedTcpSocketFactory ()
+{
+}
+
+inline void
+TracedTcpSocketFactory::DoDispose (void)
+{
+  m_cwnd = WindowCallback ();
+  m_ssThresh = WindowCallback ();
+  m_pacingRate = RateCallback ();
+  SocketFactory::DoDispose ();
+}
+
+inline Ptr<TracedTcpSocketFactory>
+TracedTcpSocketFactory::Install (Ptr<Node> node)
+{
+  Ptr<TracedTcpSocketFactory> factory = node->GetObject<TracedTcpSocketFactory> ();
+  if (factory == 0)
+    {
+      NS_ASSERT_MSG (node->GetObject<TcpL4Protocol> () != 0, "Install the Internet stack first");
+      factory = CreateObject<TracedTcpSocketFactory> ();
+      node->AggregateObject (factory);
+    }
+  return factory;
+}
+
+inline const TracedTcpSocketFactory::Accessors &
+TracedTcpSocketFactory::GetAccessors (TypeId tid)
+{
+  static std::map<uint16_t, Accessors> cache;
+  std::map<uint16_t, Accessors>::iterator it = cache.find (tid.GetUid ());
+  if (it == cache.end ())
+    {
+      Accessors accessors;
+      accessors.cwnd = tid.LookupTraceSourceByName ("CongestionWindow");
+      accessors.ssThresh = tid.LookupTraceSourceByName ("SlowStartThreshold");
+      accessors.pacingRate = tid.LookupTraceSourceByName ("PacingRate");
+      it = cache.insert (std::make_pair (tid.GetUid (), accessors)).first;
+    }
+  return it->second;
+}
+
+inline Ptr<Socket>
+TracedTcpSocketFactory::CreateSocket (void)
+{
+  Ptr<TcpL4Protocol> tcp = GetObject<TcpL4Protocol> ();
+  NS_ASSERT_MSG (tcp != 0, "TracedTcpSocketFactory needs TcpL4Protocol on its node");
+  Ptr<Socket> socket = tcp->CreateSocket ();
+  ++m_nSockets;
+
+  const Accessors &accessors = GetAccessors (socket->GetInstanceTypeId ());
+  if (!m_cwnd.IsNull () && accessors.cwnd != 0)
+    {
+      accessors.cwnd->ConnectWithoutContext (PeekPointer (socket), m_cwnd);
+    }
+  if (!m_ssThresh.IsNull () && accessors.ssThresh != 0)
+    {
+      accessors.ssThresh->ConnectWithoutContext (PeekPointer (socket), m_ssThresh);
+    }
+  if (!m_pacingRate.IsNull () && accessors.pacingRate != 0)
+    {
+      accessors.pacingRate->ConnectWithoutContext (PeekPointer (socket), m_pacingRate);
+    }
+  m_socketCreated (socket);
+  return socket;
+}
+
+inline void
+TracedTcpSocketFactory::SetCwndCallback (WindowCallback cb)
+{
+  m_cwnd = cb;
+}
+
+inline void
+TracedTcpSocketFactory::SetSsThreshCallback (WindowCallback cb)
+{
+  m_ssThresh = cb;
+}
+
+inline void
+TracedTcpSocketFactory::SetPacingRateCallback (RateCallback cb)
+{
+  m_pacingRate = cb;
+}
+
+inline uint32_t
+TracedTcpSocketFactory::GetNSockets (void) const
+{
+  return m_nSockets;
+}
+
+} // namespace ns3
+
+#endif /* TRACED_TCP_SOCKET_FACTORY_H */
@@ -0,0 +1,863 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TRAFFIC_GENERATOR_H
+#define TRAFFIC_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+// ===========================================================================
+//
+// The socket-driven sender used by the scratch scripts.  It started life as
+// the MyApp class of the tutorial's fifth/sixth/seventh examples: the script
+// creates the socket itself (so it can hook the socket's trace sources at
+// configuration time), hands it to Setup (), and the application writes
+// fixed-size packets into it until nPackets have been sent or it is stopped.
+//
+// When the next packet goes out is decided by a rate policy that is a
+// template parameter, so the per-packet timing path is an ordinary inlined
+// call.  A policy provides
+//
+//   static const char *GetTypeName (void);   TypeId name of the generator
+//   void SetRate (DataRate rate);            the (mean) sending rate
+//   DataRate GetRate (void) const;
+//   void Start (void);                       called from StartApplication
+//   Time GetGap (uint32_t bytes);            wait after sending bytes, or
+//                                            Time::Max () to pause
+//   int64_t AssignStreams (int64_t stream);  fix the random streams used
+//
+// With the Backpressure attribute set, the generator only creates a packet
+// when the socket has room for it: a send that finds the buffer full is
+// deferred until the socket's send callback reports free space.  The
+// BulkRate policy has no timer at all and simply keeps the socket buffer
+// full from that callback, like BulkSendApplication.
+//
+// ===========================================================================
+
+namespace ns3 {
+
+/**
+ * \brief Sends at a constant rate; the MyApp behaviour.
+ */
+class ConstantRate
+{
+public:
+  ConstantRate ()
+    : m_rate (0)
+  {
+  }
+  static const char *GetTypeName (void)
+  {
+    return "ns3::ConstantRateGenerator";
+  }
+  void SetRate (DataRate rate)
+  {
+    m_rate = rate;
+  }
+  DataRate GetRate (void) const
+  {
+    return m_rate;
+  }
+  void Start (void)
+  {
+  }
+  Time GetGap (uint32_t bytes)
+  {
+    if (m_rate.GetBitRate () == 0)
+      {
+        return Time::Max ();
+      }
+    return m_rate.CalculateBytesTxTime (bytes);
+  }
+  int64_t AssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+
+private:
+  DataRate m_rate; //!< sending rate
+};
+
+/**
+ * \brief Sends with exponentially distributed gaps whose mean matches the rate.
+ */
+class PoissonRate
+{
+public:
+  PoissonRate ()
+    : m_rate (0),
+      m_gap (CreateObject<ExponentialRandomVariable> ())
+  {
+  }
+  static const char *GetTypeName (void)
+  {
+    return "ns3::PoissonGenerator";
+  }
+  void SetRate (DataRate rate)
+  {
+    m_rate = rate;
+  }
+  DataRate GetRate (void) const
+  {
+    return m_rate;
+  }
+  void Start (void)
+  {
+  }
+  Time GetGap (uint32_t bytes)
+  {
+    if (m_rate.GetBitRate () == 0)
+      {
+        return Time::Max ();
+      }
+    return Seconds (m_gap->GetValue (m_rate.CalculateBytesTxTime (bytes).GetSeconds (), 0));
+  }
+  int64_t AssignStreams (int64_t stream)
+  {
+    m_gap->SetStream (stream);
+    return 1;
+  }
+
+private:
+  DataRate m_rate;                       //!< mean sending rate
+  Ptr<ExponentialRandomVariable> m_gap;  //!< gap generator
+};
+
+/**
+ * \brief Sends at a constant rate during on periods and stays silent during
+ * off periods.  The cycle starts with an on period when the application starts.
+ */
+class OnOffRate
+{
+public:
+  OnOffRate ()
+    : m_rate (0),
+      m_onTime (Seconds (1)),
+      m_offTime (Seconds (1))
+  {
+  }
+  static const char *GetTypeName (void)
+  {
+    return "ns3::OnOffGenerator";
+  }
+  void SetRate (DataRate rate)
+  {
+    m_rate = rate;
+  }
+  DataRate GetRate (void) const
+  {
+    return m_rate;
+  }
+  /**
+   * \param onTime length of each on period
+   * \param offTime length of each off period
+   */
+  void SetPeriods (Time onTime, Time offTime)
+  {
+    NS_ASSERT (onTime.IsStrictlyPositive ());
+    m_onTime = onTime;
+    m_offTime = offTime;
+  }
+  void Start (void)
+  {
+    m_origin = Simulator::Now ();
+  }
+  Time GetGap (uint32_t bytes)
+  {
+    if (m_rate.GetBitRate () == 0)
+      {
+        return Time::Max ();
+      }
+    Time next = Simulator::Now () + m_rate.CalculateBytesTxTime (bytes);
+    Time cycle = m_onTime + m_offTime;
+    Time phase = Time ((next - m_origin).GetTimeStep () % cycle.GetTimeStep ());
+    if (phase >= m_onTime)
+      {
+        next += cycle - phase;
+      }
+    return next - Simulator::Now ();
+  }
+  int64_t AssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+
+private:
+  DataRate m_rate; //!< sending rate while on
+  Time m_onTime;   //!< length of an on period
+  Time m_offTime;  //!< length of an off period
+  Time m_origin;   //!< start of the first on period
+};
+
+/**
+ * \brief Sends at a rate that follows a piecewise-constant schedule of
+ * absolute simulation times.  A zero rate pauses the sender.
+ *
+ * The gap before the next send integrates the schedule, so a step that
+ * falls inside a gap takes effect at its exact instant without an event of
+ * its own: a profile with hundreds of steps costs one vector entry per step
+ * and no extra simulator events.
+ */
+class PiecewiseRate
+{
+public:
+  /// A rate and the absolute time it starts at.
+  typedef std::pair<Time, DataRate> Step;
+
+  PiecewiseRate ()
+  {
+  }
+  static const char *GetTypeName (void)
+  {
+    return "ns3::PiecewiseRateGenerator";
+  }
+  /**
+   * Switch to \p rate from now on, dropping any later steps.
+   * \param rate the new rate
+   */
+  void SetRate (DataRate rate)
+  {
+    AddStep (Simulator::Now (), rate);
+  }
+  DataRate GetRate (void) const
+  {
+    std::vector<Step>::const_iterator it = Find (Simulator::Now ());
+    return it == m_steps.begin () ? DataRate (0) : (it - 1)->second;
+  }
+  /**
+   * Use \p rate from \p at on.  Steps at or after \p at are replaced.
+   * \param at absolute simulation time of the step
+   * \param rate the rate from \p at on
+   */
+  void AddStep (Time at, DataRate rate)
+  {
+    m_steps.erase (std::lower_bound (m_steps.begin (), m_steps.end (), Step (at, DataRate (0)), CompareStep),
+                   m_steps.end ());
+    m_steps.push_back (Step (at, rate));
+  }
+  /**
+   * Replace the whole profile.
+   * \param steps the steps, sorted by time
+   */
+  void SetSchedule (const std::vector<Step> &steps)
+  {
+    NS_ASSERT (std::is_sorted (steps.begin (), steps.end (), CompareStep));
+    m_steps = steps;
+    m_steps.shrink_to_fit ();
+  }
+  /**
+   * \return the number of steps in the profile
+   */
+  uint32_t GetNSteps (void) const
+  {
+    return m_steps.size ();
+  }
+  void Start (void)
+  {
+  }
+  Time GetGap (uint32_t bytes)
+  {
+    Time now = Simulator::Now ();
+    Time t = now;
+    double bits = bytes * 8.0;
+    std::vector<Step>::const_iterator it = Find (now);
+    if (it == m_steps.begin ())
+      {
+        // Before the first step: nothing is sent until it starts.
+        if (it == m_steps.end ())
+          {
+            return Time::Max ();
+          }
+        t = it->first;
+        ++it;
+      }
+    // (it - 1) is the segment in force at t; spend its capacity on the
+    // outstanding bits until one segment can finish them.
+    while (true)
+      {
+        double bps = static_cast<double> ((it - 1)->second.GetBitRate ());
+        if (it == m_steps.end ())
+          {
+            return bps == 0 ? Time::Max () : t - now + Seconds (bits / bps);
+          }
+        double capacity = bps * (it->first - t).GetSeconds ();
+        if (bps > 0 && capacity >= bits)
+          {
+            return t - now + Seconds (bits / bps);
+          }
+        bits -= capacity;
+        t = it->first;
+        ++it;
+      }
+  }
+  int64_t AssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+
+private:
+  static bool CompareStep (const Step &a, const Step &b)
+  {
+    return a.first < b.first;
+  }
+  /// \return the first step strictly after \p t
+  std::vector<Step>::const_iterator Find (Time t) const
+  {
+    return std::upper_bound (m_steps.begin (), m_steps.end (), Step (t, DataRate (0)), CompareStep);
+  }
+
+  std::vector<Step> m_steps; //!< rate steps, sorted by time
+};
+
+/**
+ * \brief Sends as fast as the socket accepts data.  Always driven by the
+ * socket's send callback, whatever the Backpressure attribute says.
+ */
+class BulkRate
+{
+public:
+  static const char *GetTypeName (void)
+  {
+    return "ns3::BulkGenerator";
+  }
+  void SetRate (DataRate rate)
+  {
+  }
+  DataRate GetRate (void) const
+  {
+    return DataRate (0);
+  }
+  void Start (void)
+  {
+  }
+  Time GetGap (uint32_t bytes)
+  {
+    return Time::Max ();
+  }
+  int64_t AssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+};
+
+/**
+ * \brief Whether a rate policy is paced by the socket rather than a timer.
+ */
+template <class RatePolicy>
+struct IsBulkPolicy
+{
+  static const bool value = false;
+};
+
+template <>
+struct IsBulkPolicy<BulkRate>
+{
+  static const bool value = true;
+};
+
+/**
+ * \brief Writes fixed-size packets into a caller-supplied socket with the
+ * timing given by \p RatePolicy.
+ */
+template <class RatePolicy>
+class TrafficGenerator : public Application
+{
+public:
+  /**
+   * Register this type.
+   * \return The TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  TrafficGenerator ();
+  virtual ~TrafficGenerator ();
+
+  /**
+   * \param socket the socket to send on; it is bound and connected at start
+   * \param address the peer address
+   * \param packetSize size of each packet in bytes
+   * \param nPackets number of packets to send; zero means until stopped
+   * \param dataRate the sending rate handed to the rate policy
+   */
+  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
+  /**
+   * Change the sending rate now.  A pending send is re-armed so that the
+   * part of its gap that has not yet elapsed runs at the new rate.
+   * \param rate the new sending rate
+   */
+  void ChangeRate (DataRate rate);
+  /**
+   * \return the rate policy, for policy-specific configuration
+   */
+  RatePolicy &GetRatePolicy (void);
+  /**
+   * Assign a fixed random variable stream number to the rate policy.
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \return the number of bytes the socket has accepted
+   */
+  uint64_t GetBytesSent (void) const;
+  /**
+   * \return the number of packets the socket refused
+   */
+  uint64_t GetSendFailures (void) const;
+  /**
+   * \return the number of sends deferred because the socket buffer was full
+   */
+  uint64_t GetDeferredSends (void) const;
+
+  /**
+   * \return the number of payload buffers this sender has allocated.
+   */
+  uint64_t GetPayloadAllocations (void) const;
+  /**
+   * \return the number of Packet objects this sender has created, one per
+   *         send attempt: a copy of the shared payload is still a new Packet.
+   */
+  uint64_t GetPacketsCreated (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void ScheduleTx (void);
+  void SendPacket (void);
+  void SendBulk (void);
+  void SendSpaceAvailable (Ptr<Socket> socket, uint32_t available);
+  uint32_t GetBurstLength (void) const;
+  uint32_t GetNextSize (void) const;
+  Ptr<Packet> AllocatePacket (uint32_t size);
+  bool IsDone (void) const;
+
+  RatePolicy      m_policy;
+  Ptr<Socket>     m_socket;
+  Address         m_peer;
+  uint32_t        m_packetSize;
+  uint32_t        m_nPackets;
+  EventId         m_sendEvent;
+  bool            m_running;
+  uint32_t        m_packetsSent;
+  uint32_t        m_maxBurst;
+  uint32_t        m_burstLength;
+  bool            m_backpressure;
+  bool            m_blocked;
+  bool            m_paused;
+  Time            m_lastSend;
+  uint32_t        m_pendingBytes;
+  uint64_t        m_bytesSent;
+  uint64_t        m_maxBytes;
+  uint64_t        m_sendFailures;
+  uint64_t        m_deferredSends;
+  Ptr<Packet>     m_payload;
+  uint64_t        m_payloadAllocations;
+  uint64_t        m_packetsCreated;
+};
+
+typedef TrafficGenerator<ConstantRate> ConstantRateGenerator;
+typedef TrafficGenerator<PoissonRate> PoissonGenerator;
+typedef TrafficGenerator<OnOffRate> OnOffGenerator;
+typedef TrafficGenerator<PiecewiseRate> PiecewiseRateGenerator;
+typedef TrafficGenerator<BulkRate> BulkGenerator;
+
+NS_OBJECT_ENSURE_REGISTERED (ConstantRateGenerator);
+NS_OBJECT_ENSURE_REGISTERED (PoissonGenerator);
+NS_OBJECT_ENSURE_REGISTERED (OnOffGenerator);
+NS_OBJECT_ENSURE_REGISTERED (PiecewiseRateGenerator);
+NS_OBJECT_ENSURE_REGISTERED (BulkGenerator);
+
+template <class RatePolicy>
+TypeId
+TrafficGenerator<RatePolicy>::GetTypeId (void)
+{
+  static TypeId tid = TypeId (RatePolicy::GetTypeName ())
+    .SetParent<Application> ()
+    .SetGroupName ("Tutorial")
+    .AddConstructor<TrafficGenerator<RatePolicy> > ()
+    .AddAttribute ("MaxBurst",
+                   "The maximum number of packets handed to the socket per send event. "
+                   "The gap to the next event grows with the burst so the average rate is unchanged.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&TrafficGenerator<RatePolicy>::m_maxBurst),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Backpressure",
+                   "Only create packets the socket has room for, and resume "
+                   "deferred sends from the socket's send callback.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TrafficGenerator<RatePolicy>::m_backpressure),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxBytes",
+                   "The total number of bytes to send; the last packet is cut to what is left. "
+                   "Zero means no limit beyond the number of packets.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TrafficGenerator<RatePolicy>::m_maxBytes),
+                   MakeUintegerChecker<uint64_t> ())
+    ;
+  return tid;
+}
+
+template <class RatePolicy>
+TrafficGenerator<RatePolicy>::TrafficGenerator ()
+  : m_policy (),
+    m_socket (0),
+    m_peer (),
+    m_packetSize (0),
+    m_nPackets (0),
+    m_sendEvent (),
+    m_running (false),
+    m_packetsSent (0),
+    m_maxBurst (1),
+    m_burstLength (1),
+    m_backpressure (false),
+    m_blocked (false),
+    m_paused (false),
+    m_lastSend (),
+    m_pendingBytes (0),
+    m_bytesSent (0),
+    m_maxBytes (0),
+    m_sendFailures (0),
+    m_deferredSends (0),
+    m_payload (0),
+    m_payloadAllocations (0),
+    m_packetsCreated (0)
+{
+}
+
+template <class RatePolicy>
+TrafficGenerator<RatePolicy>::~TrafficGenerator ()
+{
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::DoDispose (void)
+{
+  m_socket = 0;
+  m_payload = 0;
+  Application::DoDispose ();
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
+{
+  NS_ASSERT (packetSize > 0);
+  m_socket = socket;
+  m_peer = address;
+  m_packetSize = packetSize;
+  m_nPackets = nPackets;
+  m_policy.SetRate (dataRate);
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::ChangeRate (DataRate rate)
+{
+  m_policy.SetRate (rate);
+  if (!m_running || IsBulkPolicy<RatePolicy>::value)
+    {
+      return;
+    }
+
+  uint32_t bytes = m_pendingBytes;
+  if (m_sendEvent.IsRunning ())
+    {
+      // Only the share of the pending gap still ahead of us is re-timed.
+      Time left = Simulator::GetDelayLeft (m_sendEvent);
+      Time total = Simulator::Now () + left - m_lastSend;
+      if (total.IsStrictlyPositive ())
+        {
+          bytes = static_cast<uint32_t> (std::ceil (m_pendingBytes * (left.GetSeconds () / total.GetSeconds ())));
+        }
+      Simulator::Cancel (m_sendEvent);
+    }
+  else if (!m_paused)
+    {
+      return;
+    }
+
+  m_paused = false;
+  Time tNext = m_policy.GetGap (bytes);
+  if (tNext == Time::Max ())
+    {
+      m_paused = true;
+      return;
+    }
+  m_sendEvent = Simulator::Schedule (tNext, &TrafficGenerator<RatePolicy>::SendPacket, this);
+}
+
+template <class RatePolicy>
+RatePolicy &
+TrafficGenerator<RatePolicy>::GetRatePolicy (void)
+{
+  return m_policy;
+}
+
+template <class RatePolicy>
+int64_t
+TrafficGenerator<RatePolicy>::AssignStreams (int64_t stream)
+{
+  return m_policy.AssignStreams (stream);
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::StartApplication (void)
+{
+  m_running = true;
+  m_packetsSent = 0;
+  m_blocked = false;
+  m_paused = false;
+  m_policy.Start ();
+  if (InetSocketAddress::IsMatchingType (m_peer))
+    {
+      m_socket->Bind ();
+    }
+  else
+    {
+      m_socket->Bind6 ();
+    }
+  m_socket->Connect (m_peer);
+  if (m_backpressure || IsBulkPolicy<RatePolicy>::value)
+    {
+      m_socket->SetSendCallback (MakeCallback (&TrafficGenerator<RatePolicy>::SendSpaceAvailable, this));
+    }
+  if (IsBulkPolicy<RatePolicy>::value)
+    {
+      SendBulk ();
+    }
+  else
+    {
+      SendPacket ();
+    }
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::StopApplication (void)
+{
+  m_running = false;
+
+  if (m_sendEvent.IsRunning ())
+    {
+      Simulator::Cancel (m_sendEvent);
+    }
+
+  if (m_socket)
+    {
+      m_socket->SetSendCallback (MakeNullCallback<void, Ptr<Socket>, uint32_t> ());
+      m_socket->Close ();
+    }
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::SendPacket (void)
+{
+  if (m_backpressure && m_socket->GetTxAvailable () < m_packetSize)
+    {
+      // Nothing would fit; pick up again from SendSpaceAvailable.
+      m_blocked = true;
+      ++m_deferredSends;
+      return;
+    }
+
+  m_burstLength = GetBurstLength ();
+  for (uint32_t i = 0; i < m_burstLength && !IsDone (); ++i)
+    {
+      uint32_t size = GetNextSize ();
+      if (m_socket->Send (AllocatePacket (size)) < 0)
+        {
+          ++m_sendFailures;
+          continue;
+        }
+      m_bytesSent += size;
+      ++m_packetsSent;
+    }
+
+  if (!IsDone ())
+    {
+      ScheduleTx ();
+    }
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::SendBulk (void)
+{
+  while (m_running && !IsDone () && m_socket->GetTxAvailable () >= m_packetSize)
+    {
+      uint32_t size = GetNextSize ();
+      if (m_socket->Send (AllocatePacket (size)) < 0)
+        {
+          ++m_sendFailures;
+          break;
+        }
+      m_bytesSent += size;
+      ++m_packetsSent;
+    }
+  m_blocked = !IsDone ();
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::SendSpaceAvailable (Ptr<Socket> socket, uint32_t available)
+{
+  if (!m_running || !m_blocked || available < m_packetSize)
+    {
+      return;
+    }
+  m_blocked = false;
+  if (IsBulkPolicy<RatePolicy>::value)
+    {
+      SendBulk ();
+    }
+  else
+    {
+      SendPacket ();
+    }
+}
+
+template <class RatePolicy>
+bool
+TrafficGenerator<RatePolicy>::IsDone (void) const
+{
+  return (m_nPackets != 0 && m_packetsSent >= m_nPackets)
+         || (m_maxBytes != 0 && m_bytesSent >= m_maxBytes);
+}
+
+template <class RatePolicy>
+uint32_t
+TrafficGenerator<RatePolicy>::GetNextSize (void) const
+{
+  if (m_maxBytes != 0 && m_maxBytes - m_bytesSent < m_packetSize)
+    {
+      return static_cast<uint32_t> (m_maxBytes - m_bytesSent);
+    }
+  return m_packetSize;
+}
+
+template <class RatePolicy>
+uint32_t
+TrafficGenerator<RatePolicy>::GetBurstLength (void) const
+{
+  // Never queue more than the socket buffer can take in one go, and always
+  // send at least one packet so the flow keeps making progress.
+  uint32_t burst = m_maxBurst;
+  if (m_nPackets != 0)
+    {
+      burst = std::min (burst, m_nPackets - m_packetsSent);
+    }
+  if (m_maxBytes != 0)
+    {
+      uint64_t left = (m_maxBytes - m_bytesSent + m_packetSize - 1) / m_packetSize;
+      burst = static_cast<uint32_t> (std::min<uint64_t> (burst, left));
+    }
+  burst = std::min (burst, m_socket->GetTxAvailable () / m_packetSize);
+  return std::max<uint32_t> (burst, 1);
+}
+
+template <class RatePolicy>
+uint64_t
+TrafficGenerator<RatePolicy>::GetBytesSent (void) const
+{
+  return m_bytesSent;
+}
+
+template <class RatePolicy>
+uint64_t
+TrafficGenerator<RatePolicy>::GetSendFailures (void) const
+{
+  return m_sendFailures;
+}
+
+template <class RatePolicy>
+uint64_t
+TrafficGenerator<RatePolicy>::GetDeferredSends (void) const
+{
+  return m_deferredSends;
+}
+
+template <class RatePolicy>
+Ptr<Packet>
+TrafficGenerator<RatePolicy>::AllocatePacket (uint32_t size)
+{
+  ++m_packetsCreated;
+  if (size != m_packetSize)
+    {
+      // The last, cut packet of a MaxBytes limit
+      ++m_payloadAllocations;
+      return Create<Packet> (size);
+    }
+  // Every send still creates a Packet object; the copy only shares the
+  // payload buffer of one pristine packet instead of allocating its own.
+  // The sharing lasts until a protocol adds a header, when the buffer is
+  // copied anyway, so what is saved is one buffer allocation per packet at
+  // the application, not the Packet itself.
+  if (m_payload == 0 || m_payload->GetSize () != m_packetSize)
+    {
+      m_payload = Create<Packet> (m_packetSize);
+      ++m_payloadAllocations;
+    }
+  return m_payload->Copy ();
+}
+
+template <class RatePolicy>
+uint64_t
+TrafficGenerator<RatePolicy>::GetPayloadAllocations (void) const
+{
+  return m_payloadAllocations;
+}
+
+template <class RatePolicy>
+uint64_t
+TrafficGenerator<RatePolicy>::GetPacketsCreated (void) const
+{
+  return m_packetsCreated;
+}
+
+template <class RatePolicy>
+void
+TrafficGenerator<RatePolicy>::ScheduleTx (void)
+{
+  if (m_running)
+    {
+      m_lastSend = Simulator::Now ();
+      m_pendingBytes = m_burstLength * m_packetSize;
+      Time tNext = m_policy.GetGap (m_pendingBytes);
+      if (tNext == Time::Max ())
+        {
+          // Zero rate: ChangeRate picks the flow up again.
+          m_paused = true;
+          return;
+        }
+      m_sendEvent = Simulator::Schedule (tNext, &TrafficGenerator<RatePolicy>::SendPacket, this);
+    }
+}
+
+} // namespace ns3
+
+#endif /* TRAFFIC_GENERATOR_H */
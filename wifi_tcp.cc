@@ -14,6 +14,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include "ns3/core-module.h"
@@ -29,6 +30,11 @@
 #include "ns3/on-off-helper.h"
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/flow-monitor-module.h"
+#include "traffic-generator.h"
+#include "throughput-sampler.h"
+#include "flow-table-monitor.h"
+#include "flow-report.h"
+#include "hex-ring-position-allocator.h"
 
 using namespace ns3;
 
@@ -64,129 +70,13 @@ NS_LOG_COMPONENT_DEFINE("SeventhScriptExample");
 //
 // So first, we create a socket and do the trace connect on it; then we pass
 // this socket into the constructor of our simple application which we then
-// install in the source node.
+// install in the source node.  That application is the ConstantRateGenerator
+// from traffic-generator.h.
 //
 // NOTE: If this example gets modified, do not forget to update the .png figure
 // in src/stats/docs/seventh-packet-byte-count.png
 // ===========================================================================
 //
-class MyApp : public Application
-{
-public:
-  MyApp();
-  virtual ~MyApp();
-
-  /**
-   * Register this type.
-   * \return The TypeId.
-   */
-  static TypeId GetTypeId(void);
-  void Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
-
-private:
-  virtual void StartApplication(void);
-  virtual void StopApplication(void);
-
-  void ScheduleTx(void);
-  void SendPacket(void);
-
-  Ptr<Socket> m_socket;
-  Address m_peer;
-  uint32_t m_packetSize;
-  uint32_t m_nPackets;
-  DataRate m_dataRate;
-  EventId m_sendEvent;
-  bool m_running;
-  uint32_t m_packetsSent;
-};
-
-MyApp::MyApp()
-    : m_socket(0),
-      m_peer(),
-      m_packetSize(0),
-      m_nPackets(0),
-      m_dataRate(0),
-      m_sendEvent(),
-      m_running(false),
-      m_packetsSent(0)
-{
-}
-
-MyApp::~MyApp()
-{
-  m_socket = 0;
-}
-
-/* static */
-TypeId MyApp::GetTypeId(void)
-{
-  static TypeId tid = TypeId("MyApp")
-                          .SetParent<Application>()
-                          .SetGroupName("Tutorial")
-                          .AddConstructor<MyApp>();
-  return tid;
-}
-
-void MyApp::Setup(Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
-{
-  m_socket = socket;
-  m_peer = address;
-  m_packetSize = packetSize;
-  m_nPackets = nPackets;
-  m_dataRate = dataRate;
-}
-
-void MyApp::StartApplication(void)
-{
-  m_running = true;
-  m_packetsSent = 0;
-  if (InetSocketAddress::IsMatchingType(m_peer))
-  {
-    m_socket->Bind();
-  }
-  else
-  {
-    m_socket->Bind6();
-  }
-  m_socket->Connect(m_peer);
-  SendPacket();
-}
-
-void MyApp::StopApplication(void)
-{
-  m_running = false;
-
-  if (m_sendEvent.IsRunning())
-  {
-    Simulator::Cancel(m_sendEvent);
-  }
-
-  if (m_socket)
-  {
-    m_socket->Close();
-  }
-}
-
-void MyApp::SendPacket(void)
-{
-  Ptr<Packet> packet = Create<Packet>(m_packetSize);
-  m_socket->Send(packet);
-  Time now = Simulator::Now();
-  if (now.GetSeconds() < 20)
-  {
-    ScheduleTx();
-  }
-}
-
-void MyApp::ScheduleTx(void)
-{
-  if (m_running)
-  {
-    Time tNext(Seconds(m_packetSize * 8 / static_cast<double>(m_dataRate.GetBitRate())));
-    m_sendEvent = Simulator::Schedule(tNext, &MyApp::SendPacket, this);
-  }
-}
-
 // static void
 // CwndChange(Ptr<OutputStreamWrapper> stream, uint32_t oldCwnd, uint32_t newCwnd)
 // {
@@ -195,57 +85,25 @@ void MyApp::ScheduleTx(void)
 // }
 
 ApplicationContainer sinks;      /* Pointer to the packet sink application */
-uint64_t lastTotalRx[100]; /* The value of the last total received bytes */
-
-Ptr<OutputStreamWrapper> throughputStream[100];
-
-void CalculateThroughput()
-{
-  for (uint32_t i = 0; i < sinks.GetN(); i++)
-  {
-    Ptr<PacketSink> sink;
-    sink = StaticCast<PacketSink> (sinks.Get(i));
-    Time now = Simulator::Now();                                        /* Return the simulator's virtual time. */
-    double cur = (sink->GetTotalRx() - lastTotalRx[i]) * (double)8 / 1024; /* Convert Application RX Packets to KBits. */
-    if(cur != 0)
-    *throughputStream[i]->GetStream() << Simulator::Now().GetSeconds() << "		" << cur << std::endl;
-     std::cout << now.GetSeconds() << "s: \t" << cur << " Kbit/s" << std::endl;
-    lastTotalRx[i] = sink->GetTotalRx();
-  }
-
-  Simulator::Schedule(MilliSeconds(500), &CalculateThroughput);
-}
 
 int main(int argc, char *argv[])
 {
   // Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpNewAIMD"));
   //  bool useV6 = false;
   bool verbose = true;
+  uint32_t nWifi = 8;
 
   CommandLine cmd(__FILE__);
   // cmd.AddValue("useIpv6", "Use Ipv6", useV6);
+  cmd.AddValue("nWifi", "Number of wifi STA devices per BSS", nWifi);
   cmd.Parse(argc, argv);
 
   uint32_t txArea = 5;
-  uint32_t nWifi = 8;
   uint32_t pps = 500;
   uint32_t p_size = 128;
   std::string dataRate = std::to_string((8 * pps * p_size) / 1024) + "kbps";
-  uint32_t SentPackets = 0;
-  uint32_t ReceivedPackets = 0;
-  uint32_t LostPackets = 0;
-  int num_half_flows = 8;
-  AsciiTraceHelper graph;
-  for(int i = 0; i < num_half_flows; i++){
-	  std::string num = std::to_string(i);
-	  throughputStream[i] = graph.CreateFileStream("throughput" + num);
-  }
-
-  if (nWifi > 18)
-  {
-    std::cout << "nWifi should be 18 or less; otherwise grid layout exceeds the bounding box" << std::endl;
-    return 1;
-  }
+  // One flow per station pair, at most 8
+  int num_half_flows = std::min(8, int(nWifi));
 
   if (verbose)
   {
@@ -330,20 +188,26 @@ int main(int argc, char *argv[])
 
   MobilityHelper mobility;
 
-  mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                                "MinX", DoubleValue(0.0),
-                                "MinY", DoubleValue(0.0),
-                                "DeltaX", DoubleValue(5.0),
-                                "DeltaY", DoubleValue(10.0),
-                                "GridWidth", UintegerValue(3),
-                                "LayoutType", StringValue("RowFirst"));
-
   mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
 
-  mobility.Install(wifiStaNodes0);
-  mobility.Install(wifiStaNodes1);
+  // Each BSS is a disc of hexagonal rings around its AP, the centre, well
+  // inside the range of the AP; the stations move closer together as
+  // nWifi grows, so the disc keeps its radius.
+  double bssRadius = 8.0 * txArea;
+  double spacing = std::min(5.0, HexRingPositionAllocator::GetSpacing(nWifi + 1, bssRadius));
+  mobility.SetPositionAllocator("ns3::HexRingPositionAllocator",
+                                "X", DoubleValue(0.0),
+                                "Y", DoubleValue(0.0),
+                                "Spacing", DoubleValue(spacing));
   mobility.Install(wifiApNode0);
+  mobility.Install(wifiStaNodes0);
+
+  mobility.SetPositionAllocator("ns3::HexRingPositionAllocator",
+                                "X", DoubleValue(2 * bssRadius + spacing),
+                                "Y", DoubleValue(0.0),
+                                "Spacing", DoubleValue(spacing));
   mobility.Install(wifiApNode1);
+  mobility.Install(wifiStaNodes1);
 
   InternetStackHelper stack;
   stack.Install(p2pNodes);
@@ -351,8 +215,10 @@ int main(int argc, char *argv[])
   stack.Install(wifiStaNodes0);
   stack.Install(wifiStaNodes1);
 
-  FlowMonitorHelper flowmon;
-  Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+  Ptr<FlowTableMonitor> monitor = CreateObject<FlowTableMonitor>();
+  monitor->SetAttribute("ExpectedFlows", UintegerValue(2 * num_half_flows));
+  monitor->SetAttribute("LatencyHistograms", BooleanValue(true));
+  monitor->InstallAll();
 
   uint16_t sinkPort = 8080;
   Address sinkAddress;
@@ -364,12 +230,14 @@ int main(int argc, char *argv[])
   Ipv4InterfaceContainer p2pInterfaces;
   p2pInterfaces = address.Assign(p2pDevices);
 
-  address.SetBase("10.1.2.0", "255.255.255.0");
+  // A /24 holds 253 stations and the AP; a larger BSS gets a /16
+  bool wideBss = nWifi > 253;
+  address.SetBase(wideBss ? "10.2.0.0" : "10.1.2.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer wifiInterfaces0, apInterfaces0;
   wifiInterfaces0 = address.Assign(staDevices0);
   apInterfaces0 = address.Assign(apDevices0);
 
-  address.SetBase("10.1.3.0", "255.255.255.0");
+  address.SetBase(wideBss ? "10.3.0.0" : "10.1.3.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer wifiInterfaces1, apInterfaces1;
   wifiInterfaces1 = address.Assign(staDevices1);
   apInterfaces1 = address.Assign(apDevices1);
@@ -391,63 +259,52 @@ int main(int argc, char *argv[])
 
     Ptr<Socket> ns3TcpSocket = Socket::CreateSocket(wifiStaNodes1.Get(i), TcpSocketFactory::GetTypeId());
 
-    Ptr<MyApp> app = CreateObject<MyApp>();
-    app->Setup(ns3TcpSocket, sinkAddress, p_size, 1000, DataRate(dataRate)); // packets per second = (1040*2000)/10^6
+    Ptr<ConstantRateGenerator> app = CreateObject<ConstantRateGenerator>();
+    app->Setup(ns3TcpSocket, sinkAddress, p_size, 0, DataRate(dataRate)); // send until stopped
     wifiStaNodes1.Get(i)->AddApplication(app);
     app->SetStartTime(Seconds(1.));
     app->SetStopTime(Seconds(11.));
-
-    Simulator::Schedule(Seconds(1.1), &CalculateThroughput);
   }
 
+  // One row per 500 ms with the Kbit/s of every flow
+  Ptr<ThroughputSampler> sampler = CreateObject<ThroughputSampler>();
+  sampler->SetAttribute("Unit", DoubleValue(1024));
+  sampler->Add(sinks);
+  sampler->Start("throughput", Seconds(1.1), MilliSeconds(500));
+
   Simulator::Stop(Seconds(10));
 
   Simulator::Run();
-
-  int j = 0;
-  float AvgThroughput = 0;
-  Time Jitter;
-  Time Delay;
-
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-  std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats();
-
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin(); iter != stats.end(); ++iter)
+  sampler->Stop();
+
+  FlowReport report;
+  report.SetUnit(1024, "Kbps");
+  report.AddAll(monitor);
+  report.GroupBy([sinkPort](const FlowReport::FiveTuple &t) { return t.destinationPort == sinkPort ? "data" : "ack"; });
+  report.Compute();
+  report.Print(std::cout);
+  report.WriteCsv("wifi_tcp-flows.csv");
+
+  LatencyHistogram AllDelays;
+  for (FlowId id = 1; id <= monitor->GetNFlows(); ++id)
   {
-    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(iter->first);
-
-    NS_LOG_UNCOND("----Flow ID:" << iter->first);
-    NS_LOG_UNCOND("Src Addr" << t.sourceAddress << "Dst Addr " << t.destinationAddress);
-    NS_LOG_UNCOND("Sent Packets=" << iter->second.txPackets);
-    NS_LOG_UNCOND("Received Packets =" << iter->second.rxPackets);
-    NS_LOG_UNCOND("Lost Packets =" << iter->second.txPackets - iter->second.rxPackets);
-    NS_LOG_UNCOND("Packet delivery ratio =" << iter->second.rxPackets * 100 / iter->second.txPackets << "%");
-    NS_LOG_UNCOND("Packet loss ratio =" << (iter->second.txPackets - iter->second.rxPackets) * 100 / iter->second.txPackets << "%");
-    NS_LOG_UNCOND("Delay =" << iter->second.delaySum);
-    NS_LOG_UNCOND("Jitter =" << iter->second.jitterSum);
-    NS_LOG_UNCOND("Throughput =" << iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1024 << "Kbps");
-
-    SentPackets = SentPackets + (iter->second.txPackets);
-    ReceivedPackets = ReceivedPackets + (iter->second.rxPackets);
-    LostPackets = LostPackets + (iter->second.txPackets - iter->second.rxPackets);
-    AvgThroughput = AvgThroughput + (iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1024);
-    Delay = Delay + (iter->second.delaySum);
-    Jitter = Jitter + (iter->second.jitterSum);
-
-    j = j + 1;
+    const LatencyHistogram &delays = monitor->GetLatencyHistogram(id);
+    NS_LOG_UNCOND("Flow " << id << " delay p50/p99/p99.9 = " << delays.GetPercentile(50).As(Time::MS) << " / "
+                  << delays.GetPercentile(99).As(Time::MS) << " / " << delays.GetPercentile(99.9).As(Time::MS));
+    AllDelays.Merge(delays);
+  }
+  NS_LOG_UNCOND("End to End Delay p50/p99/p99.9 = " << AllDelays.GetPercentile(50).As(Time::MS) << " / "
+                << AllDelays.GetPercentile(99).As(Time::MS) << " / " << AllDelays.GetPercentile(99.9).As(Time::MS));
+  if (monitor->GetSamplingRate() > 1)
+  {
+    // The report above counts sampled packets only
+    FlowTableMonitor::Estimate sent = monitor->EstimateTotal(FlowTableMonitor::TX_PACKETS);
+    FlowTableMonitor::Estimate received = monitor->EstimateTotal(FlowTableMonitor::RX_PACKETS);
+    NS_LOG_UNCOND("Sampled 1 in " << monitor->GetSamplingRate()
+                  << (monitor->GetSamplingMode() == FlowTableMonitor::SAMPLE_FLOW ? " flows" : " packets"));
+    NS_LOG_UNCOND("Estimated sent packets = " << sent.value << " +/- " << sent.error);
+    NS_LOG_UNCOND("Estimated received packets = " << received.value << " +/- " << received.error);
   }
-
-  AvgThroughput = AvgThroughput / j;
-  NS_LOG_UNCOND("--------Total Results of the simulation----------" << std::endl);
-  NS_LOG_UNCOND("Total sent packets  =" << SentPackets);
-  NS_LOG_UNCOND("Total Received Packets =" << ReceivedPackets);
-  NS_LOG_UNCOND("Total Lost Packets =" << LostPackets);
-  NS_LOG_UNCOND("Packet Loss ratio =" << ((LostPackets * 100) / SentPackets) << "%");
-  NS_LOG_UNCOND("Packet delivery ratio =" << ((ReceivedPackets * 100) / SentPackets) << "%");
-  NS_LOG_UNCOND("Average Throughput =" << AvgThroughput << "Kbps");
-  NS_LOG_UNCOND("End to End Delay =" << Delay);
-  NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
-  NS_LOG_UNCOND("Total Flow " << j);
   // monitor->SerializeToXmlFile("wifi_tcp.xml", true, true);
   Simulator::Destroy();
 
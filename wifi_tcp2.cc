@@ -55,22 +55,14 @@
 #include "ns3/ssid.h"
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/flow-monitor-module.h"
+#include "throughput-histogram.h"
+#include "flow-report.h"
 
 NS_LOG_COMPONENT_DEFINE("wifi-tcp");
 
 using namespace ns3;
 
 Ptr<PacketSink> sink;     /* Pointer to the packet sink application */
-uint64_t lastTotalRx = 0; /* The value of the last total received bytes */
-
-void CalculateThroughput()
-{
-    Time now = Simulator::Now();                                       /* Return the simulator's virtual time. */
-    double cur = (sink->GetTotalRx() - lastTotalRx) * (double)8 / 1024; /* Convert Application RX Packets to KBits. */
-    std::cout << now.GetSeconds() << "s: \t" << cur << " Kbit/s" << std::endl;
-    lastTotalRx = sink->GetTotalRx();
-    Simulator::Schedule(MilliSeconds(100), &CalculateThroughput);
-}
 
 int main(int argc, char *argv[])
 {
@@ -84,9 +76,6 @@ int main(int argc, char *argv[])
     uint32_t nWifi = 5;
     //uint32_t pps = 500;
     int num_half_flow = 4;
-    uint32_t SentPackets = 0;
-    uint32_t ReceivedPackets = 0;
-    uint32_t LostPackets = 0;
 
     // ./waf --run scratch/wifi_tcp2 --payloadSize=2048
     /* Command line argument parser setup. */
@@ -240,6 +229,9 @@ int main(int argc, char *argv[])
     Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
     em->SetAttribute("ErrorRate", DoubleValue(0.00001));
 
+    /* Rx accounting for every sink, read back after the run */
+    Ptr<ThroughputHistogram> histogram = CreateObject<ThroughputHistogram>();
+
     /* Install TCP Receiver on the access point */
     for (int i = 0; i < num_half_flow; i++)
     {
@@ -247,6 +239,7 @@ int main(int argc, char *argv[])
         PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), 9));
         ApplicationContainer sinkApp = sinkHelper.Install(wifiStaNodes0.Get(i));
         sink = StaticCast<PacketSink>(sinkApp.Get(0));
+        histogram->Add(sink);
 
         /* Install TCP/UDP Transmitter on the station */
         OnOffHelper server("ns3::TcpSocketFactory", (InetSocketAddress(wifiInterfaces0.GetAddress(i), 9)));
@@ -260,7 +253,6 @@ int main(int argc, char *argv[])
         sinkApp.Start(Seconds(0.0));
         serverApp.Start(Seconds(1.0));
     }
-    Simulator::Schedule(Seconds(1.1), &CalculateThroughput);
 
     /* Enable Traces */
     if (pcapTracing)
@@ -274,50 +266,15 @@ int main(int argc, char *argv[])
     Simulator::Stop(Seconds(simulationTime + 1));
     AnimationInterface anim("wifi_tcp2.xml");
     Simulator::Run();
-    int j = 0;
-    float AvgThroughput = 0;
-    Time Jitter;
-    Time Delay;
-
+    histogram->Print(std::cout, MilliSeconds(100), Seconds(1), Seconds(simulationTime + 1), 1024); // Kbit/s
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
-    std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats();
-
-    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin(); iter != stats.end(); ++iter)
-    {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(iter->first);
-
-        NS_LOG_UNCOND("----Flow ID:" << iter->first);
-        NS_LOG_UNCOND("Src Addr" << t.sourceAddress << "Dst Addr " << t.destinationAddress);
-        NS_LOG_UNCOND("Sent Packets=" << iter->second.txPackets);
-        NS_LOG_UNCOND("Received Packets =" << iter->second.rxPackets);
-        NS_LOG_UNCOND("Lost Packets =" << iter->second.txPackets - iter->second.rxPackets);
-        NS_LOG_UNCOND("Packet delivery ratio =" << iter->second.rxPackets * 100 / iter->second.txPackets << "%");
-        NS_LOG_UNCOND("Packet loss ratio =" << (iter->second.txPackets - iter->second.rxPackets) * 100 / iter->second.txPackets << "%");
-        NS_LOG_UNCOND("Delay =" << iter->second.delaySum);
-        NS_LOG_UNCOND("Jitter =" << iter->second.jitterSum);
-        NS_LOG_UNCOND("Throughput =" << iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1024 << "Kbps");
-
-        SentPackets = SentPackets + (iter->second.txPackets);
-        ReceivedPackets = ReceivedPackets + (iter->second.rxPackets);
-        LostPackets = LostPackets + (iter->second.txPackets - iter->second.rxPackets);
-        AvgThroughput = AvgThroughput + (iter->second.rxBytes * 8.0 / (iter->second.timeLastRxPacket.GetSeconds() - iter->second.timeFirstTxPacket.GetSeconds()) / 1024);
-        Delay = Delay + (iter->second.delaySum);
-        Jitter = Jitter + (iter->second.jitterSum);
-
-        j = j + 1;
-    }
-
-    AvgThroughput = AvgThroughput / j;
-    NS_LOG_UNCOND("--------Total Results of the simulation----------" << std::endl);
-    NS_LOG_UNCOND("Total sent packets  =" << SentPackets);
-    NS_LOG_UNCOND("Total Received Packets =" << ReceivedPackets);
-    NS_LOG_UNCOND("Total Lost Packets =" << LostPackets);
-    NS_LOG_UNCOND("Packet Loss ratio =" << ((LostPackets * 100) / SentPackets) << "%");
-    NS_LOG_UNCOND("Packet delivery ratio =" << ((ReceivedPackets * 100) / SentPackets) << "%");
-    NS_LOG_UNCOND("Average Throughput =" << AvgThroughput << "Kbps");
-    NS_LOG_UNCOND("End to End Delay =" << Delay);
-    NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
-    NS_LOG_UNCOND("Total Flow " << j);
+    FlowReport report;
+    report.SetUnit(1024, "Kbps");
+    report.AddAll(monitor, classifier);
+    report.GroupBy([](const FlowReport::FiveTuple &t) { return t.destinationPort == 9 ? "data" : "ack"; });
+    report.Compute();
+    report.Print(std::cout);
+    report.WriteJson("wifi_tcp2-flows.json");
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);
 
     double averageThroughput = ((sink->GetTotalRx() * 8) / (1024 * simulationTime));
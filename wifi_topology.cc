@@ -23,6 +23,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ssid.h"
+#include "hex-ring-position-allocator.h"
 
 // Default Network Topology
 // We are chaning this 
@@ -56,15 +57,6 @@ main (int argc, char *argv[])
 
   cmd.Parse (argc,argv);
 
-  // The underlying restriction of 18 is due to the grid position
-  // allocator's configuration; the grid layout will exceed the
-  // bounding box if more than 18 nodes are provided.
-  if (nWifi > 18)
-    {
-      std::cout << "nWifi should be 18 or less; otherwise grid layout exceeds the bounding box" << std::endl;
-      return 1;
-    }
-
   if (verbose)
     {
       LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
@@ -132,22 +124,30 @@ main (int argc, char *argv[])
 
   MobilityHelper mobility;
 
-  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
-                                 "MinX", DoubleValue (0.0),
-                                 "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (5.0),
-                                 "DeltaY", DoubleValue (10.0),
-                                 "GridWidth", UintegerValue (3),
-                                 "LayoutType", StringValue ("RowFirst"));
-
+  // Each BSS is a disc of hexagonal rings around its AP, the centre; the
+  // two discs sit side by side inside the bounds of the random walk, and
+  // the stations move closer together as nWifi grows.
+  double bssRadius = 20.0;
+  double spacing = std::min (5.0, HexRingPositionAllocator::GetSpacing (nWifi + 1, bssRadius));
+  mobility.SetPositionAllocator ("ns3::HexRingPositionAllocator",
+                                 "X", DoubleValue (-25.0),
+                                 "Y", DoubleValue (0.0),
+                                 "Spacing", DoubleValue (spacing));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (wifiApNode0);
   mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
                              "Bounds", RectangleValue (Rectangle (-50, 50, -50, 50)));
   mobility.Install (wifiStaNodes0);
-  mobility.Install (wifiStaNodes1);
 
+  mobility.SetPositionAllocator ("ns3::HexRingPositionAllocator",
+                                 "X", DoubleValue (25.0),
+                                 "Y", DoubleValue (0.0),
+                                 "Spacing", DoubleValue (spacing));
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.Install (wifiApNode0);
   mobility.Install (wifiApNode1);
+  mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                             "Bounds", RectangleValue (Rectangle (-50, 50, -50, 50)));
+  mobility.Install (wifiStaNodes1);
 
   InternetStackHelper stack;
   stack.Install(p2pNodes);
@@ -170,7 +170,9 @@ main (int argc, char *argv[])
 //   Ipv4InterfaceContainer csmaInterfaces;
 //   csmaInterfaces = address.Assign (csmaDevices);
 
-  address.SetBase ("10.1.2.0", "255.255.255.0");
+  // A /24 holds 253 stations and the AP; a larger BSS gets a /16
+  bool wideBss = nWifi > 253;
+  address.SetBase (wideBss ? "10.2.0.0" : "10.1.2.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer wifiInterfaces0, apInterfaces0;
   wifiInterfaces0 = address.Assign (staDevices0);
   apInterfaces0 = address.Assign (apDevices0);
@@ -182,7 +184,7 @@ main (int argc, char *argv[])
   //   staticRouting->SetDefaultRoute (apInterfaces0.GetAddress(0), 1 );
   // }
 
-  address.SetBase ("10.1.3.0", "255.255.255.0");
+  address.SetBase (wideBss ? "10.3.0.0" : "10.1.3.0", wideBss ? "255.255.0.0" : "255.255.255.0");
   Ipv4InterfaceContainer wifiInterfaces1, apInterfaces1;
   wifiInterfaces1 = address.Assign (staDevices1);
   apInterfaces1 = address.Assign (apDevices1);